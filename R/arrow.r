@@ -0,0 +1,86 @@
+# ===============================================================================
+#
+# PROGRAMMERS:
+#
+# jean-romain.roussel.1@ulaval.ca  -  https://github.com/Jean-Romain/rlas
+#
+# COPYRIGHT:
+#
+# Copyright 2016-2018 Jean-Romain Roussel
+#
+# This file is part of the rlas R package.
+#
+# rlas is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>
+#
+# ===============================================================================
+
+
+#' Exchange point clouds with Arrow based tools
+#'
+#' Read and write point clouds using the
+#' \href{https://arrow.apache.org/docs/format/CDataInterface.html}{Arrow C Data Interface}. The
+#' point cloud is not converted into a \code{data.table}. The columns read by LASlib are moved
+#' into an Arrow struct array (a record batch) whose memory is owned by its release callback. Handing
+#' the point cloud to another engine (\code{arrow}, \code{nanoarrow}, \code{duckdb}, \code{polars}...)
+#' is thus a pointer exchange and not a copy. rlas does not depend on any Arrow library.\cr\cr
+#' \code{read_arrow.las} returns a list with two external pointers \code{schema} and \code{array}
+#' to an \code{ArrowSchema} and an \code{ArrowArray}. Columns are named and ordered like in
+#' \link{read.las}. The consumer may move the structs (e.g. \code{arrow::RecordBatch$import_from_c}
+#' or \code{nanoarrow}). Otherwise they are released when the external pointers are garbage collected.
+#' Full waveform samples are not exported.\cr\cr
+#' \code{write_arrow.las} writes a struct array into a las or laz file. The array is not consumed
+#' and must be released by its owner. The schema and the array can be external pointers or the
+#' address of the structs stored in a \code{numeric} or in a \code{character} like the \code{arrow}
+#' package does. Column names must respect the nomenclature of \link{write.las}. Unlike
+#' \link{write.las} only the header is checked: the data are not tested against the LAS specification.
+#'
+#' @param files,file character. Path(s) to .las or .laz file(s)
+#' @param select,filter,sort see \link{read.las}
+#' @param header list. See \link{write.las}
+#' @param schema,array Arrow C Data Interface structs. See details.
+#' @return \code{read_arrow.las} returns a list with two external pointers \code{schema} and \code{array}.
+#' \code{write_arrow.las} returns nothing.
+#' @export
+#' @rdname arrow
+#' @examples
+#' lasfile <- system.file("extdata", "example.las", package="rlas")
+#' header  <- read.lasheader(lasfile)
+#' ptr     <- read_arrow.las(lasfile)
+#'
+#' file <- file.path(tempdir(), "temp.laz")
+#' write_arrow.las(file, header, ptr$schema, ptr$array)
+read_arrow.las = function(files, select = "*", filter = "", sort = "")
+{
+  ifiles    <- enc2native(normalizePath(files))
+  valid     <- file.exists(ifiles)
+  supported <- tools::file_ext(ifiles) %in% c("las", "laz", "LAS", "LAZ", "ply", "PLY")
+
+  if (!all(valid))      stop("File not found", call. = F)
+  if (!all(supported))  stop("File not supported", call. = F)
+
+  check_filter(filter)
+  check_sort(sort)
+
+  return(C_reader_arrow(ifiles, select, filter, sort, list()))
+}
+
+#' @export
+#' @rdname arrow
+write_arrow.las = function(file, header, schema, array)
+{
+  file <- path.expand(file)
+  check_output_file(file)
+  check_header_validity(header)
+  C_writer_arrow(file, header, schema, array)
+}
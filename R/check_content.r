@@ -41,24 +41,7 @@ check_las_validity = function(header, data)
   is_valid_filesourceid(header, "stop")
 
   is_valid_XYZ(data, "stop")
-  is_valid_Intensity(data, "stop")
-  is_valid_ReturnNumber(data, header, "stop")
-  is_valid_NumberOfReturns(data, header, "stop")
-  is_valid_ScanDirectionFlag(data, "stop")
-  is_valid_EdgeOfFlightline(data, "stop")
-  is_valid_Classification(data, header, "stop")
-  is_valid_ScannerChannel(data, "stop")
-  is_valid_SyntheticFlag(data, "stop")
-  is_valid_KeypointFlag(data, "stop")
-  is_valid_WithheldFlag(data, "stop")
-  is_valid_OverlapFlag(data, "stop")
-  is_valid_ScanAngleRank(data, "stop")
-  is_valid_ScanAngle(data, "stop")
-  is_valid_UserData(data, "stop")
-  is_valid_gpstime(data, "stop")
-  is_valid_PointSourceID(data, "stop")
-  is_valid_RGB(data, "stop")
-  is_valid_NIR(data, "stop")
+  is_valid_attributes(data, header, "stop")
 
   is_NIR_in_valid_format(header, data, "warning")
   is_gpstime_in_valid_format(header, data, "warning")
@@ -103,6 +86,27 @@ check_las_compliance = function(header, data)
   return(invisible())
 }
 
+check_header_validity = function(header)
+{
+  is_defined_offsets(header, "stop")
+  is_defined_scalefactors(header, "stop")
+  is_defined_filesourceid(header, "stop")
+  is_defined_version(header, "stop")
+  is_defined_globalencoding(header, "stop")
+  is_defined_date(header, "stop")
+  is_defined_pointformat(header, "stop")
+
+  is_valid_offsets(header, "stop")
+  is_valid_scalefactors(header, "stop")
+  is_valid_globalencoding(header, "stop")
+  is_valid_date(header, "stop")
+  is_valid_pointformat(header, "stop")
+  is_valid_extrabytes(header, "stop")
+  is_valid_filesourceid(header, "stop")
+
+  return(invisible())
+}
+
 check_output_file = function(file)
 {
   islas = tools::file_ext(file) %in% c("las", "laz")
@@ -131,4 +135,13 @@ check_filter = function(filter)
 {
   if (!is.character(filter) & length(filter) > 1)
     stop("Incorrect argument 'filter'. A string is expected.")
-}
\ No newline at end of file
+}
+
+check_sort = function(sort)
+{
+  if (!is.character(sort) || length(sort) != 1L)
+    stop("Incorrect argument 'sort'. A string is expected.")
+
+  if (!sort %in% c("", "morton", "hilbert", "gpstime"))
+    stop("Incorrect argument 'sort'. Should be 'morton', 'hilbert' or 'gpstime'.")
+}
@@ -8,6 +8,13 @@
 #' needs to be updated. But most of the original information is not modified, for example point data
 #' format is kept 'as is'.
 #'
+#' The bounding box, the number of points by return and the number of decimals of the coordinates
+#' are computed in a single multithreaded pass. \code{header_create} uses the scale factor of the grid
+#' the coordinates are already on (up to 7 decimals) so they are written without loss, otherwise the
+#' scale factor of the most frequent number of decimals. \link{write.las} recomputes the bounding box
+#' and the number of points by return while writing, calling \code{header_update} before writing is
+#' not required.
+#'
 #' @param data data.frame or data.table
 #' @param header list. A header
 #' @family header_tools
@@ -35,17 +42,17 @@
 #' @rdname public_header_block_tools
 header_create = function(data)
 {
-  fields = names(data)
+  inv = header_inventory(data, 5L)
 
   if (nrow(data) > 0L)
   {
     npts = nrow(data)
-    minx = min(data$X)
-    miny = min(data$Y)
-    minz = min(data$Z)
-    maxx = max(data$X)
-    maxy = max(data$Y)
-    maxz = max(data$Z)
+    minx = inv$min[1]
+    miny = inv$min[2]
+    minz = inv$min[3]
+    maxx = inv$max[1]
+    maxy = inv$max[2]
+    maxz = inv$max[3]
   }
   else
   {
@@ -91,9 +98,9 @@ header_create = function(data)
   header[["Z scale factor"]] = 0.01
 
 
-  scalex <- guess_scale_factor(data$X)
-  scaley <- guess_scale_factor(data$Y)
-  scalez <- guess_scale_factor(data$Z)
+  scalex <- inv$scale[1]
+  scaley <- inv$scale[2]
+  scalez <- inv$scale[3]
   if (scalex == scaley && scalex == scalez)
   {
     header[["X scale factor"]] <- scalex
@@ -101,10 +108,7 @@ header_create = function(data)
     header[["Z scale factor"]] <- scalez
   }
 
-  if ("ReturnNumber" %in% fields)
-    header[["Number of points by return"]] <- tabulate(data$ReturnNumber, 5L)
-  else
-    header[["Number of points by return"]] <- rep(0L,5)
+  header[["Number of points by return"]] <- inv$returns
 
   header[["Point Data Format ID"]] <- guess_las_format(data)
   header[["Point Data Record Length"]] <- get_data_record_length(header[["Point Data Format ID"]])
@@ -125,17 +129,20 @@ header_create = function(data)
 #' @rdname public_header_block_tools
 header_update = function(header, data)
 {
-  fields = names(data)
+  n <- 5
+  if (!is.null(header[["Version Minor"]]) && header[["Version Minor"]] >= 4) n <- 15L
+
+  inv = header_inventory(data, n)
 
   if (nrow(data) > 0L)
   {
     npts = nrow(data)
-    minx = min(data$X)
-    miny = min(data$Y)
-    minz = min(data$Z)
-    maxx = max(data$X)
-    maxy = max(data$Y)
-    maxz = max(data$Z)
+    minx = inv$min[1]
+    miny = inv$min[2]
+    minz = inv$min[3]
+    maxx = inv$max[1]
+    maxy = inv$max[2]
+    maxz = inv$max[3]
   }
   else
   {
@@ -148,14 +155,7 @@ header_update = function(header, data)
     maxz = 0
   }
 
-  n <- 5
-  if (!is.null(header[["Version Minor"]]) && header[["Version Minor"]] >= 4) n <- 15L
-
-  if ("ReturnNumber" %in% fields)
-    header[["Number of points by return"]] <- tabulate(data$ReturnNumber, n)
-  else
-    header[["Number of points by return"]] <- integer(n)
-
+  header[["Number of points by return"]] <- inv$returns
   header[["Number of point records"]] = npts
   header[["Min X"]] = minx
   header[["Min Y"]] = miny
@@ -475,13 +475,38 @@ guess_las_format <- function(data)
   return(min(formats))
 }
 
-guess_scale_factor <- function(x)
+# Number of points, bounding box, number of points by return and scale factors of the coordinates
+# computed in a single pass in C++. The scale factor of a coordinate is the finest grid of 10^-n with
+# n < 8 the coordinates are already on ('quantized' is TRUE) so they are written without loss.
+# Otherwise it is the most frequent number of decimals. The scale is made coarser if the extent of the
+# coordinates from the offset (floor of the min) does not fit in the integers of the point records.
+header_inventory = function(data, nreturns)
 {
-  u <- fast_decimal_count(x)
-  u <- tabulate(u)
-  n <- which.max(u)
-  scale = 1/10^n
-  return(scale)
+  rn <- if ("ReturnNumber" %in% names(data)) data[["ReturnNumber"]] else integer(0)
+  inv <- fast_header_inventory(data[["X"]], data[["Y"]], data[["Z"]], rn)
+
+  returns <- inv$returns[seq_len(nreturns) + 1L]
+  if (all(returns <= .Machine$integer.max)) returns <- as.integer(returns)
+  inv$returns <- returns
+
+  inv$quantized <- logical(3)
+  inv$scale <- numeric(3)
+  for (k in 1:3)
+  {
+    u <- inv$decimals[, k]
+    d <- max(which(u > 0L), 1L) - 1L
+    inv$quantized[k] <- d < 8L
+    n <- if (d < 8L) max(d, 1L) else which.max(u[-1L])
+    extent <- inv$max[k] - floor(inv$min[k])
+    while (n > 0L && is.finite(extent) && extent * 10^n > .Machine$integer.max)
+    {
+      n <- n - 1L
+      inv$quantized[k] <- FALSE
+    }
+    inv$scale[k] <- 1/10^n
+  }
+
+  return(inv)
 }
 
 get_data_record_length <- function(format)
@@ -40,57 +40,67 @@ error_handling_engine = function(errors, behavior)
   }
 }
 
-is_no_na_integer_on_n_bits <- function(x, nbits, name, signed = TRUE, behavior = "bool")
+# range is c(na, min, max) as returned by C_column_ranges(). It is computed if not provided.
+column_range <- function(x)
+{
+  return(C_column_ranges(list(x))[[1]])
+}
+
+is_no_na_integer_on_n_bits <- function(x, nbits, name, signed = TRUE, behavior = "bool", range = NULL)
 {
-  na.rm = FALSE
   errors = character(0)
 
   if (is.null(x))
     return(error_handling_engine(errors, behavior))
 
-  if (anyNA(x))
-  {
+  if (is.null(range))
+    range <- column_range(x)
+
+  if (range[["na"]])
     errors <- append(errors, paste("Invalid data:",  name, "contains some NAs"))
-    na.rm <- TRUE
-  }
 
   if (!is.integer(x))
     errors = append(errors, paste("Invalid data:", name, "is not an integer"))
 
+  if (is.na(range[["min"]]))
+    return(error_handling_engine(errors, behavior))
+
   if (!signed)
   {
-    if (min(x, na.rm = na.rm) < 0)
+    if (range[["min"]] < 0)
       errors = append(errors, paste("Invalid data:", name, "is not an unsigned integer"))
   }
   else
   {
-    if (min(x, na.rm = na.rm) < -2L^(nbits - 1))
+    if (range[["min"]] < -2L^(nbits - 1))
       errors = append(errors, paste("Invalid data:", name, "is not an integer on", nbits, "bits"))
   }
 
   if (!signed)
   {
-    if (max(x, na.rm = na.rm) > 2L^nbits - 1)
+    if (range[["max"]] > 2L^nbits - 1)
       errors = append(errors, paste("Invalid data:", name, "is not an unsigned integer on", nbits, "bits"))
   }
   else
   {
-    if (max(x, na.rm = na.rm) > 2L^(nbits - 1) - 1)
+    if (range[["max"]] > 2L^(nbits - 1) - 1)
       errors = append(errors, paste("Invalid data:", name, "is not an unsigned integer on", nbits, "bits"))
   }
 
   return(error_handling_engine(errors, behavior))
 }
 
-is_no_na_bool <- function(x, name, behavior = "bool")
+is_no_na_bool <- function(x, name, behavior = "bool", range = NULL)
 {
-  na.rm = FALSE
   errors = character(0)
 
   if (is.null(x))
     return(error_handling_engine(errors, behavior))
 
-  if (anyNA(x))
+  if (is.null(range))
+    range <- column_range(x)
+
+  if (range[["na"]])
     errors <- append(errors, paste("Invalid data:",  name, "contains some NAs"))
 
   if (!is.logical(x))
@@ -99,15 +109,17 @@ is_no_na_bool <- function(x, name, behavior = "bool")
   return(error_handling_engine(errors, behavior))
 }
 
-is_no_na_double <- function(x, name, behavior = "bool")
+is_no_na_double <- function(x, name, behavior = "bool", range = NULL)
 {
-  na.rm = FALSE
   errors = character(0)
 
   if (is.null(x))
     return(error_handling_engine(errors, behavior))
 
-  if (anyNA(x))
+  if (is.null(range))
+    range <- column_range(x)
+
+  if (range[["na"]])
     errors <- append(errors, paste("Invalid data:",  name, "contains some NAs"))
 
   if (!is.double(x))
@@ -569,23 +581,77 @@ is_valid_OverlapFlag = function(data, behavior = "bool")
 #' @rdname las_specification_tools
 is_valid_ScanAngle = function(data, behavior = "bool")
 {
-  na.rm = FALSE
+  return(is_no_na_scan_angle(data[["ScanAngle"]], behavior = behavior))
+}
+
+is_no_na_scan_angle <- function(x, name = "ScanAngle", behavior = "bool", range = NULL)
+{
   errors = character(0)
 
-  if (anyNA(data[["ScanAngle"]]))
-  {
-    errors <- append(errors, paste("Invalid data: ScanAngle contains some NAs."))
-    na.rm <- TRUE
-  }
+  if (is.null(x))
+    return(error_handling_engine(errors, behavior))
 
-  if (is.null(data[["ScanAngle"]]))
+  if (is.null(range))
+    range <- column_range(x)
+
+  if (range[["na"]])
+    errors <- append(errors, paste0("Invalid data: ", name, " contains some NAs."))
+
+  if (is.na(range[["min"]]))
     return(error_handling_engine(errors, behavior))
 
-  if (min(data[["ScanAngle"]], na.rm = na.rm) < -196.6)
-    errors = append(errors, "Invalid data: ScanAngle greater than -180 degrees.")
+  if (range[["min"]] < -196.6)
+    errors = append(errors, paste("Invalid data:", name, "greater than -180 degrees."))
+
+  if (range[["max"]] > 196.6)
+    errors = append(errors, paste("Invalid data:", name, "greater than 180 degrees"))
+
+  return(error_handling_engine(errors, behavior))
+}
+
+# All the is_valid_* tests of the attributes of the points with a single multithreaded pass on the
+# data. The errors are the same than the individual tests and are all reported at once.
+is_valid_attributes = function(data, header, behavior = "bool")
+{
+  nret <- if (is_extended(header)) 4L else 3L
+  ncls <- if (is_extended(header)) 8L else 5L
+
+  specs <- list(
+    list("Intensity", is_no_na_integer_on_n_bits, nbits = 16L, signed = FALSE),
+    list("ReturnNumber", is_no_na_integer_on_n_bits, nbits = nret, signed = FALSE),
+    list("NumberOfReturns", is_no_na_integer_on_n_bits, nbits = nret, signed = FALSE),
+    list("ScanDirectionFlag", is_no_na_integer_on_n_bits, nbits = 1L, signed = FALSE),
+    list("EdgeOfFlightline", is_no_na_integer_on_n_bits, nbits = 1L, signed = FALSE),
+    list("Classification", is_no_na_integer_on_n_bits, nbits = ncls, signed = FALSE),
+    list("ScannerChannel", is_no_na_integer_on_n_bits, nbits = 2L, signed = FALSE),
+    list("Synthetic_flag", is_no_na_bool),
+    list("Keypoint_flag", is_no_na_bool),
+    list("Withheld_flag", is_no_na_bool),
+    list("Overlap_flag", is_no_na_bool),
+    list("ScanAngleRank", is_no_na_integer_on_n_bits, nbits = 8L, signed = TRUE),
+    list("ScanAngle", is_no_na_scan_angle),
+    list("UserData", is_no_na_integer_on_n_bits, nbits = 8L, signed = FALSE),
+    list("gpstime", is_no_na_double),
+    list("PointSourceID", is_no_na_integer_on_n_bits, nbits = 16L, signed = FALSE),
+    list("R", is_no_na_integer_on_n_bits, nbits = 16L, signed = FALSE),
+    list("G", is_no_na_integer_on_n_bits, nbits = 16L, signed = FALSE),
+    list("B", is_no_na_integer_on_n_bits, nbits = 16L, signed = FALSE),
+    list("NIR", is_no_na_integer_on_n_bits, nbits = 16L, signed = FALSE))
+
+  specs <- Filter(function(spec) !is.null(data[[spec[[1]]]]), specs)
+  columns <- lapply(specs, function(spec) data[[spec[[1]]]])
+  ranges <- C_column_ranges(columns)
+
+  errors <- character(0)
+  for (i in seq_along(specs))
+  {
+    spec <- specs[[i]]
+    args <- list(columns[[i]], name = spec[[1]], behavior = "vector", range = ranges[[i]])
+    errors <- c(errors, do.call(spec[[2]], c(args, spec[-(1:2)])))
+  }
 
-  if (max(data[["ScanAngle"]], na.rm = na.rm) > 196.6)
-    errors = append(errors, "Invalid data: ScanAngle greater than 180 degrees")
+  if (behavior == "stop" && length(errors) > 0)
+    stop(paste(errors, collapse = "\n"), call. = FALSE)
 
   return(error_handling_engine(errors, behavior))
 }
@@ -771,8 +837,8 @@ is_gpstime_in_valid_format = function(header, data, behavior = "bool")
   if (is.null(data[["gpstime"]]))
     return(error_handling_engine(errors, behavior))
 
-  if (!header[["Point Data Format ID"]] %in% c(1,3,4,5,6,7,8))
-    errors = append(errors, "Invalid file: the data contains a 'gpstime' attribute but point data format is not set to 1, 3, 6, 7 or 8.")
+  if (!header[["Point Data Format ID"]] %in% c(1,3:10))
+    errors = append(errors, "Invalid file: the data contains a 'gpstime' attribute but point data format is not set to 1, 3, 4, 5, 6, 7, 8, 9 or 10.")
 
   return(error_handling_engine(errors, behavior))
 }
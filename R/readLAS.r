@@ -58,7 +58,25 @@
 #' to read the binary files. Thus the package inherits the transform commands available in
 #' \href{https://rapidlasso.de/product-overview/}{LAStools}. To use these transformations the user can pass the
 #' common commands from \code{LAStools} into the parameter \code{'transform'}. Type \code{read.las(transform = "-help")}
-#' to display the \code{LASlib} documentation and the available transformations.
+#' to display the \code{LASlib} documentation and the available transformations.\cr\cr
+#' \strong{Sort:} the 'sort' argument reorders the points before they are returned. "morton" and
+#' "hilbert" sort the points along a Z-order or a Hilbert space filling curve computed on the quantized
+#' X and Y coordinates. Consecutive points are thus spatially close, which speeds up most spatial
+#' algorithms. "gpstime" sorts the points by acquisition time. The sort is a parallel radix sort
+#' performed in C++ by \code{getOption("rlas.threads")} threads (default 2) before the data are handed to R and is much faster and much less memory
+#' demanding than sorting the \code{data.table} in R. Points with equal keys keep their original order.\cr\cr
+#' \strong{Cache:} reading a laz file is bounded by the speed of the arithmetic decoder. When
+#' \code{cache} is enabled, the first read writes the decoded columns in a columnar file in the cache
+#' directory and the following reads of the same files with the same \code{select}, \code{filter},
+#' \code{transform} and \code{sort} memory map this file (see \link{read_shared.las}). A cache file is
+#' invalidated when the size or the modification time of a source file changes. If \code{cache = TRUE}
+#' the cache directory is \code{getOption("rlas.cache.dir")} or a directory in the temporary directory
+#' of the session. Set the option to a persistent directory to reuse the cache across sessions.\cr\cr
+#' \strong{Memory budget:} before reading, the peak memory of the read is estimated from the headers
+#' (see \link{memory_estimate.las}). If it exceeds \code{memory_budget} the function fails immediately
+#' instead of exhausting the memory of the machine. The default budget is
+#' \code{getOption("rlas.memory_budget")} or no budget. Use \code{filter} and \code{select} to
+#' reduce the memory required, or \link{read_and_write.las} to stream the points into a file.
 #'
 #' @section Full Waveform:
 #' The support of full waveform is still in development. The version 1.4.1 introduced the
@@ -67,12 +85,18 @@
 #' easier to manipulate (but that uses more memory). The current behaviour is not set
 #' in stone and is prone to design modification until version 1.5.0 where we aims to
 #' get enough insight to lock our engineering choices to something that suit best the needs.
+#' The points and their raw waveforms can be written back with \link{write.las}.
 #'
 #'
 #' @param files array of characters
 #' @param select character. select only columns of interest to save memory (see details)
 #' @param filter character. streaming filters - filter data while reading the file (see details)
 #' @param transform character. streaming transformation - transform data while reading the file (see details)
+#' @param sort character. Can be "morton", "hilbert" or "gpstime" to reorder the points (see details).
+#' Default is "" i.e. the points are returned in the order of the files.
+#' @param cache logical or character. \code{TRUE} to enable the cache or the path to a cache directory
+#' (see details).
+#' @param memory_budget numeric. Maximum memory in bytes the read is allowed to use (see details).
 #' @return A \code{data.table}
 #' @export
 #' @examples
@@ -82,8 +106,9 @@
 #' lasdata <- read.las(lasfile, filter = "-keep_first")
 #' lasdata <- read.las(lasfile, filter = "-drop_intensity_below 80")
 #' lasdata <- read.las(lasfile, select = "xyzia")
+#' lasdata <- read.las(lasfile, sort = "hilbert")
 #' @useDynLib rlas, .registration = TRUE
-read.las = function(files, select = "*", filter = "", transform = "")
+read.las = function(files, select = "*", filter = "", transform = "", sort = "", cache = FALSE, memory_budget = getOption("rlas.memory_budget", Inf))
 {
     if (filter == "-h" | filter == "-help")
       lasfilterusage()
@@ -95,7 +120,113 @@ read.las = function(files, select = "*", filter = "", transform = "")
       return(invisible())
 
   filter = paste(filter, transform)
-  stream.las(files, select = select, filter = filter)
+
+  if (is.finite(memory_budget))
+    check_memory_budget(files, select, filter, sort, memory_budget)
+
+  if (!isFALSE(cache))
+    return(read_cached.las(files, select, filter, sort, cache))
+
+  stream.las(files, select = select, filter = filter, sort = sort)
+}
+
+#' Read coordinates as an interleaved matrix
+#'
+#' Reads .las or .laz files like \link{read.las} but the coordinates are returned in a 3 x n matrix
+#' (one column per point) instead of three columns X, Y and Z. The coordinates of a point are thus
+#' contiguous in memory (XYZXYZ...) as expected by most spatial indexes and neighbour search
+#' libraries. The matrix is filled while the points are read and handed to R without copy.
+#' With \code{quantized = TRUE} the matrix contains the integer coordinates quantized with the
+#' scale factors and offsets of the header, recorded in the attributes \code{scale} and \code{offset}
+#' of the matrix, i.e. \code{X = xyz[1,] * scale[1] + offset[1]}.
+#'
+#' @param files,select,filter,sort see \link{read.las}
+#' @param quantized logical. Return integer coordinates instead of doubles.
+#' @return A \code{list} with a 3 x n matrix \code{xyz} and a \code{data.table} \code{data} with the
+#' other attributes.
+#' @export
+#' @examples
+#' lasfile <- system.file("extdata", "example.las", package="rlas")
+#' las <- read_matrix.las(lasfile)
+#' dim(las$xyz)
+#' las <- read_matrix.las(lasfile, select = "xyzc", quantized = TRUE)
+#' attr(las$xyz, "scale")
+read_matrix.las = function(files, select = "*", filter = "", sort = "", quantized = FALSE)
+{
+  stopifnot(is.logical(quantized), length(quantized) == 1L)
+
+  ifiles    <- enc2native(normalizePath(files))
+  valid     <- file.exists(ifiles)
+  supported <- tools::file_ext(ifiles) %in% c("las", "laz", "LAS", "LAZ", "ply", "PLY")
+
+  if (!all(valid))      stop("File not found", call. = F)
+  if (!all(supported))  stop("File not supported", call. = F)
+
+  check_filter(filter)
+  check_sort(sort)
+
+  raw_list <- C_reader_matrix(ifiles, select, filter, sort, list(), quantized)
+  xyz <- raw_list[[1L]]
+  n <- ncol(xyz)
+
+  data <- lapply(raw_list[-1L], function(attr) if (n > 1L && length(attr) == 1L) R_compact_rep(n, attr) else attr)
+  data.table::setDT(data)
+
+  return(list(xyz = xyz, data = data))
+}
+
+#' Estimate the memory required to read .las or .laz files
+#'
+#' Estimates the memory required by \link{read.las} without reading the files. The estimate is
+#' computed from the number of points, the point format and the extra bytes recorded in the headers
+#' and from the attributes selected. When a filter is used, its selectivity is estimated by filtering
+#' the first \code{sample} points. The estimate is an upper bound: attributes stored with a single
+#' value are counted as populated and full waveform samples are not counted. Sorting the points
+#' requires the sort keys and the permutation in addition to the columns.
+#'
+#' @param files array of characters
+#' @param select,filter,sort see \link{read.las}
+#' @param sample integer. Number of points read to estimate the selectivity of the filter. 0 to assume
+#' that every point is retained.
+#' @return A \code{list} with the number of points in the files, the selectivity of the filter, the
+#' number of points sampled, the expected number of points read, the size in bytes of the
+#' \code{data.table} returned and the peak memory in bytes during the read.
+#' @export
+#' @examples
+#' lasfile <- system.file("extdata", "example.las", package="rlas")
+#' memory_estimate.las(lasfile)
+#' memory_estimate.las(lasfile, select = "xyz", filter = "-keep_first")
+#' memory_estimate.las(lasfile, sort = "hilbert")
+memory_estimate.las = function(files, select = "*", filter = "", sort = "", sample = 100000L)
+{
+  ifiles    <- enc2native(normalizePath(files))
+  valid     <- file.exists(ifiles)
+  supported <- tools::file_ext(ifiles) %in% c("las", "laz", "LAS", "LAZ", "ply", "PLY")
+
+  if (!all(valid))      stop("File not found", call. = F)
+  if (!all(supported))  stop("File not supported", call. = F)
+
+  check_filter(filter)
+  check_sort(sort)
+
+  return(C_memory_estimate(ifiles, select, filter, sort, as.integer(sample)))
+}
+
+check_memory_budget = function(files, select, filter, sort, memory_budget)
+{
+  if (!is.numeric(memory_budget) || length(memory_budget) != 1L || is.na(memory_budget) || memory_budget <= 0)
+    stop("Incorrect argument 'memory_budget'. A positive number of bytes is expected.", call. = F)
+
+  estimate <- memory_estimate.las(files, select, filter, sort)
+
+  if (estimate$peak > memory_budget)
+  {
+    msg <- sprintf("Reading %.0f points requires about %.1f MB but the memory budget is %.1f MB. Use 'select' or 'filter' to read less data or read_and_write.las() to stream the points into a file.",
+                   estimate$points, estimate$peak/1024^2, memory_budget/1024^2)
+    stop(msg, call. = F)
+  }
+
+  return(invisible(estimate))
 }
 
 #' Read header from a .las or .laz file
@@ -130,7 +261,7 @@ read.lasheader = function(file)
 #' @param ifiles,ofile characters. Streaming operations.
 #' @param polygons list. Internal use only.
 #' @export
-read_and_write.las = function(ifiles, ofile = "", select = "*", filter = "", polygons = list())
+read_and_write.las = function(ifiles, ofile = "", select = "*", filter = "", polygons = list(), sort = "")
 {
   stream    <- ofile != ""
   ifiles    <- enc2native(normalizePath(ifiles))
@@ -142,9 +273,20 @@ read_and_write.las = function(ifiles, ofile = "", select = "*", filter = "", pol
   if (!all(supported))  stop("File not supported", call. = F)
 
   check_filter(filter)
+  check_sort(sort)
+
+  if (stream && sort != "") stop("Points can be sorted only when they are read in memory.", call. = F)
 
-  raw_list <- C_reader(ifiles, ofile, select, filter, polygons)
+  raw_list <- C_reader(ifiles, ofile, select, filter, sort, polygons)
 
+  if (stream) return(invisible())
+
+  return(as_lasdata(raw_list))
+}
+
+# Columns not populated are returned by the C++ readers as length 1 vectors
+as_lasdata = function(raw_list)
+{
   data <- raw_list[1:3]
   data.table::setDT(data)
   n <- nrow(data)
@@ -155,8 +297,6 @@ read_and_write.las = function(ifiles, ofile = "", select = "*", filter = "", pol
     data[[name]] <- attr
   }
 
-  if (stream) return(invisible())
-
   return(data)
 }
 
@@ -0,0 +1,117 @@
+# ===============================================================================
+#
+# PROGRAMMERS:
+#
+# jean-romain.roussel.1@ulaval.ca  -  https://github.com/Jean-Romain/rlas
+#
+# COPYRIGHT:
+#
+# Copyright 2016-2018 Jean-Romain Roussel
+#
+# This file is part of the rlas R package.
+#
+# rlas is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>
+#
+# ===============================================================================
+
+
+#' Share a point cloud between R processes
+#'
+#' \code{read_shared.las} reads a point cloud like \link{read.las} but the decoded columns are written
+#' in a memory mapped file instead of being allocated by R. The columns of the returned \code{data.table}
+#' are ALTREP vectors that view the mapping. \code{attach_shared.las} maps an existing file in another
+#' process of the same host. All the processes that attached the file share the same physical
+#' memory (the page cache of the operating system): sixteen workers on one point cloud do not mean
+#' sixteen copies of it.\cr\cr
+#' The columns can be modified: the mapping is private and copy-on-write, thus only the pages
+#' modified are copied in the memory of the process and the file is never modified. Serializing
+#' the columns (e.g. sending the point cloud to a worker with \code{parallel} or \code{future})
+#' serializes only the path of the file. The worker attaches the file when unserializing. The file
+#' must thus remain on disk as long as it is used. It can be removed with \link[base:file.remove]{file.remove}
+#' when it is no longer needed. Full waveform samples are not supported.
+#'
+#' @param files,select,filter,sort see \link{read.las}
+#' @param file character. Path to the file that stores the columns. By default a temporary file.
+#' @return A \code{data.table}
+#' @export
+#' @rdname shared
+#' @examples
+#' lasfile <- system.file("extdata", "example.las", package="rlas")
+#' shared  <- tempfile(fileext = ".rlas")
+#' las     <- read_shared.las(lasfile, file = shared)
+#'
+#' # In another R process on the same host
+#' las2    <- attach_shared.las(shared)
+read_shared.las = function(files, select = "*", filter = "", sort = "", file = tempfile(fileext = ".rlas"))
+{
+  ifiles    <- enc2native(normalizePath(files))
+  file      <- enc2native(normalizePath(file, mustWork = FALSE))
+  valid     <- file.exists(ifiles)
+  supported <- tools::file_ext(ifiles) %in% c("las", "laz", "LAS", "LAZ", "ply", "PLY")
+
+  if (!all(valid))      stop("File not found", call. = F)
+  if (!all(supported))  stop("File not supported", call. = F)
+  if (length(file) != 1L) stop("Write only one file at a time.", call. = F)
+
+  check_filter(filter)
+  check_sort(sort)
+
+  C_reader_columnar(ifiles, select, filter, sort, list(), file, "")
+
+  return(attach_shared.las(file))
+}
+
+#' @export
+#' @rdname shared
+attach_shared.las = function(file)
+{
+  file <- enc2native(normalizePath(file, mustWork = FALSE))
+  if (!file.exists(file)) stop("File not found", call. = F)
+
+  raw_list <- C_columnar_attach(file)
+  return(as_lasdata(raw_list))
+}
+
+read_cached.las = function(files, select, filter, sort, cache)
+{
+  dir <- if (isTRUE(cache)) getOption("rlas.cache.dir", file.path(tempdir(), "rlas-cache")) else cache
+
+  if (!is.character(dir) || length(dir) != 1L)
+    stop("Incorrect argument 'cache'. TRUE, FALSE or a directory is expected.", call. = F)
+
+  ifiles    <- enc2native(normalizePath(files))
+  valid     <- file.exists(ifiles)
+  supported <- tools::file_ext(ifiles) %in% c("las", "laz", "LAS", "LAZ", "ply", "PLY")
+
+  if (!all(valid))      stop("File not found", call. = F)
+  if (!all(supported))  stop("File not supported", call. = F)
+
+  check_filter(filter)
+  check_sort(sort)
+
+  if (!dir.exists(dir)) dir.create(dir, recursive = TRUE)
+
+  # The name of the cache file depends on what is read. The key stored in the file also depends on
+  # the state of the source files so a modified source file invalidates the cache file.
+  info  <- file.info(ifiles)
+  id    <- paste(c(ifiles, select, filter, sort), collapse = "\n")
+  key   <- paste(c(id, info$size, format(as.numeric(info$mtime), digits = 17), as.character(utils::packageVersion("rlas"))), collapse = "\n")
+  cfile <- file.path(dir, paste0(tools::file_path_sans_ext(basename(ifiles[1])), "-", fast_hash(id), ".rlas"))
+  cfile <- enc2native(normalizePath(cfile, mustWork = FALSE))
+
+  if (!identical(C_columnar_key(cfile), key))
+    C_reader_columnar(ifiles, select, filter, sort, list(), cfile, key)
+
+  return(attach_shared.las(cfile))
+}
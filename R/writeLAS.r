@@ -40,11 +40,49 @@
 #' the \href{https://community.asprs.org/leadership-restricted/leadership-content/public-documents/standards}{LAS file format}.
 #' Otherwise users can rely on automated procedures that are expected to be sufficient for most usages.
 #'
+#' A file with the extension \code{.copc.laz} is written as a
+#' \href{https://copc.io}{Cloud Optimized Point Cloud}. The points are organized in an octree and each
+#' octant is an independent compressed chunk of points, so readers can query a region or a level of detail
+#' without an index file. The octants are compressed in parallel. The header must be a LAS 1.4 header
+#' with point data format 6, 7 or 8. The octree is deep enough for the octants to hold about
+#' \code{getOption("rlas.copc_points_per_node")} points (default 100000).
+#'
+#' The 'sort' argument reorders the points before they are written, with the same keys as the 'sort'
+#' argument of \link{read.las}. Points sorted along a space filling curve ("morton" or "hilbert") are
+#' spatially coherent, which improves the compression of the coordinates and the locality of the
+#' reads. In a laz file of point data format 6 or more, the chunks of compressed points end at the
+#' boundaries of the cells of the curve, so a chunk covers a compact region. "gpstime" writes the
+#' points in acquisition order. Sorting is ignored for COPC files that are always written by octant.
+#'
+#' Point data formats 4, 5, 9 and 10 record full waveform. The waveforms are written in the external
+#' \code{.wdp} (or \code{.wdz} if the wave packet descriptors are compressed) file of the file from the
+#' attributes returned by \link{read.las} (WDPIndex, WDPOffset, WDPLocation, Xt, Yt, Zt and FWF) and
+#' the wave packet descriptors of the header. A packet shared by several returns is written once.
+#' Returns whose shared packet belonged to a point that is not written, or written more than 65536
+#' packets before them, have no waveform.
+#'
+#' With \code{index = TRUE} the lax file of the file is written with the points (see \link{writelax}).
+#' The spatial index is built from the coordinates as they are written so the file is not read and
+#' decoded again.
+#'
+#' With \code{append = TRUE} the points are written after the points of an existing file (see
+#' \link{open_writer.las}). The file is modified in place and is valid again once all the points
+#' are written.
+#'
+#' The laz files are compressed, and the points are sorted and validated, in parallel by
+#' \code{getOption("rlas.threads")} threads (default 2, at most the number of threads available to
+#' OpenMP).
+#'
 #' @param file character. file path to .las or .laz file
 #' @param header list. Can be partially recycled from another file (see \link{read.lasheader}) and
 #' updated with \link{header_update} or generated with \link{header_create}.
 #' @param data data.frame or data.table that contains the data to write in the file. Column names must
 #' respect the imposed nomenclature (see details)
+#' @param sort character. "morton", "hilbert" or "gpstime" to write the points in a spatial or
+#' temporal order (see details). By default the points are written in the order of \code{data}.
+#' @param index logical. If \code{TRUE} a lax file is written along with the file (see details).
+#' @param append logical. If \code{TRUE} and the file exists, the points are appended to the points
+#' of the file (see details).
 #' @export
 #' @importFrom Rcpp sourceCpp
 #' @family rlas
@@ -68,21 +106,242 @@
 #' file = file.path(tempdir(), "temp.las")
 #'
 #' write.las(file, lasheader, lasdata)
-write.las = function(file, header, data)
+write.las = function(file, header, data, sort = "", index = FALSE, append = FALSE)
 {
+  stopifnot(is.logical(index), length(index) == 1L, is.logical(append), length(append) == 1L)
   file <- path.expand(file)
   check_output_file(file)
+  check_sort(sort)
+  data <- prepare_data_for_writer(header, data)
+
+  if (append && file.exists(file))
+  {
+    if (sort != "" || index)
+      stop("'sort' and 'index' cannot be used to append points to a file.")
+
+    writer <- open_writer.las(file, header, append = TRUE)
+    C_writer_write(writer$pointer, data)
+    C_writer_close(writer$pointer)
+    return(invisible())
+  }
+
+  if (grepl("\\.copc\\.laz$", file, ignore.case = TRUE))
+    C_writer_copc(file, header, data, getOption("rlas.copc_points_per_node", 100000))
+  else
+    C_writer(file, header, data, sort, index)
+}
+
+#' @rdname write.las
+#' @param compress logical. If \code{TRUE} the point cloud is encoded in laz format, otherwise in las format.
+#' @return \code{write_raw.las} returns a \code{raw} vector containing the bytes of a las or laz file.
+#' It can be serialized, sent to another R process or stored in a database and written on disk later
+#' with \link[base:readBin]{writeBin}.
+#' @export
+#' @examples
+#'
+#' raw = write_raw.las(lasheader, lasdata)
+#' file = file.path(tempdir(), "temp.laz")
+#' writeBin(raw, file)
+write_raw.las = function(header, data, compress = TRUE)
+{
+  stopifnot(is.logical(compress), length(compress) == 1L)
+  data <- prepare_data_for_writer(header, data)
+  C_writer_raw(header, data, compress)
+}
+
+prepare_data_for_writer = function(header, data)
+{
   check_las_validity(header, data)
 
-  # If the attribute is a compact ALTREP it contains only a single value
-  # No need to handle that with Rcpp, it is difficult. Instead we pass a single value to initialize
-  # LASpoints
+  # The columns compressed with ALTREP (compact repetitions, narrow integers, block compression)
+  # are given as is. C_writer reads them without expanding them in memory.
   data <- as.list(data)
-  for (name in names(data)) {
-    val <- data[[name]][1]
-    if (is_compressed(data[[name]]))  data[[name]] = val[1]
-  }
+  return(data)
+}
+
+#' Write a .las or .laz file chunk by chunk
+#'
+#' Write a .las or .laz file by chunks of points without holding the whole point cloud in memory.
+#' \code{open_writer.las} opens a file and writes the header, \code{write_chunk.las} appends the points
+#' of a table to the file and \code{close_writer.las} closes the file. The number of points, the number
+#' of points by return and the bounding box of the header are computed from the points written and
+#' updated when the writer is closed. Other fields of the header are written as provided. A writer that
+#' is not closed is closed when it is garbage collected.
+#'
+#' With \code{append = TRUE} the points are written after the points of an existing las or laz file.
+#' The points of the file are neither read nor written again, so appending a few points to a large file
+#' is fast. Only the points of the last chunk of a laz file, when it is not full, are compressed again
+#' with the new points. The header must have the point data format, the scale factors, the offsets and
+#' the extra bytes attributes of the file, and is the header of the file by default. The counts and
+#' the bounding box of the header of the file are updated at close, its other fields and its variable
+#' length records are kept. COPC files and files of full waveform cannot be appended. A file that does
+#' not exist is created.
+#' 
+#' The file is modified in place: the new points are written over what follows the points of the file
+#' (the last chunk when it is not full, the chunk table and the extended variable length records).
+#' This is written again after the new points and the end of the file is cut when the writer is
+#' closed. The file is left untouched if the points cannot be appended, but it is not a valid file
+#' until the writer is closed.
+#'
+#' @param file character. file path to .las or .laz file
+#' @param header list. The header of the file (see \link{write.las}). Every chunk must respect this
+#' header, in particular the scale factors, the offsets and the extra bytes attributes.
+#' @param index logical. If \code{TRUE} the lax file of the file is written at close (see \link{writelax}).
+#' The coordinates of the points written are kept in memory (8 bytes per point) until then.
+#' @param append logical. If \code{TRUE} and the file exists, the points are appended to the points
+#' of the file (see details).
+#' @param writer a \code{las_writer} returned by \code{open_writer.las}
+#' @param data data.frame or data.table that contains the points to append (see \link{write.las})
+#' @export
+#' @family rlas
+#' @return \code{open_writer.las} returns a \code{las_writer}. Other functions return nothing.
+#' @examples
+#' lasfile <- system.file("extdata", "example.las", package="rlas")
+#' header  <- read.lasheader(lasfile)
+#' data    <- read.las(lasfile)
+#' file    <- file.path(tempdir(), "temp.laz")
+#'
+#' writer <- open_writer.las(file, header)
+#' write_chunk.las(writer, data[1:15,])
+#' write_chunk.las(writer, data[16:30,])
+#' close_writer.las(writer)
+#'
+#' writer <- open_writer.las(file, append = TRUE)
+#' write_chunk.las(writer, data[1:10,])
+#' close_writer.las(writer)
+open_writer.las = function(file, header, index = FALSE, append = FALSE)
+{
+  stopifnot(is.logical(index), length(index) == 1L, is.logical(append), length(append) == 1L)
+  file <- path.expand(file)
+  check_output_file(file)
+
+  append <- append && file.exists(file)
+
+  if (append && index)
+    stop("Cannot write the lax file of a file open for append. Use writelax() once the writer is closed.")
+
+  if (append && missing(header))
+    header <- read.lasheader(file)
+
+  check_header_validity(header)
+
+  # The extra bytes columns are checked chunk by chunk. At opening there are only the descriptions.
+  columns <- as.character(names(header$`Variable Length Records`$Extra_Bytes$`Extra Bytes Description`))
+
+  pointer <- C_writer_open(file, header, columns, index, append)
+  writer  <- structure(list(pointer = pointer, header = header), class = "las_writer")
+  return(writer)
+}
+
+#' @export
+#' @rdname open_writer.las
+write_chunk.las = function(writer, data)
+{
+  stopifnot(inherits(writer, "las_writer"))
+  data <- prepare_data_for_writer(writer$header, data)
+  C_writer_write(writer$pointer, data)
+  return(invisible())
+}
+
+#' @export
+#' @rdname open_writer.las
+close_writer.las = function(writer)
+{
+  stopifnot(inherits(writer, "las_writer"))
+  C_writer_close(writer$pointer)
+  return(invisible())
+}
+
+#' Write the header of an existing .las or .laz file
+#'
+#' Writes a header in an existing .las or .laz file without reading nor writing the points, to fix
+#' the CRS, the file source ID, the GUID or the date of a file or to add small variable length records.
+#' The variable length records of the header (CRS, extra bytes descriptions, ...) replace those of
+#' the file. Other records of the file (e.g. laszip) are kept.\cr\cr
+#' The header is written in place when the variable length records fit in the space before the points.
+#' Otherwise the WKT string of a LAS 1.4 file is moved into an extended variable length record after
+#' the points, or the bytes of the points are moved (not decoded) to make room. The point data format,
+#' the scale factors, the offsets and the extra bytes attributes of the header must be those of the
+#' file. The number of points and the bounding box of the file are kept. The points of a COPC file and
+#' of a laz file with an internal index cannot be moved.
+#'
+#' @param file character. file path to an existing .las or .laz file
+#' @param header list. The header of the file (see \link{read.lasheader}) modified for example with
+#' \link{header_set_epsg} or \link{header_set_wktcs}.
+#' @export
+#' @family rlas
+#' @return void
+#' @examples
+#' lasfile <- system.file("extdata", "example.las", package="rlas")
+#' file    <- file.path(tempdir(), "temp.las")
+#' file.copy(lasfile, file, overwrite = TRUE)
+#'
+#' header <- read.lasheader(file)
+#' header[["File Source ID"]] <- 12L
+#' header <- header_set_epsg(header, 2949)
+#' write.lasheader(file, header)
+write.lasheader = function(file, header)
+{
+  check_file(file)
+  check_header_validity(header)
+  file <- enc2native(normalizePath(file))
+
+  columns <- as.character(names(header$`Variable Length Records`$Extra_Bytes$`Extra Bytes Description`))
+
+  lasheaderwriter(file, header, columns)
+  return(invisible())
+}
+
+#' Write attributes of the points of an existing .las file
+#'
+#' Writes columns of attributes in the points of an existing uncompressed .las file, for example to
+#' write a new classification, without writing the whole file again with \link{write.las}. The records
+#' of the points have a fixed size: they are read by large batches, only the bits of the attributes
+#' given are modified, and they are written back at the same place. The other bytes of the file are
+#' not modified, except the number of points by return of the header when the return numbers change.
+#'
+#' The attributes that can be written are "Intensity", "ReturnNumber", "NumberOfReturns",
+#' "ScanDirectionFlag", "EdgeOfFlightline", "Classification", "Synthetic_flag", "Keypoint_flag",
+#' "Withheld_flag", "Overlap_flag", "ScannerChannel", "ScanAngleRank", "ScanAngle", "UserData",
+#' "PointSourceID", "gpstime", "R", "G", "B" and "NIR" when the point data format of the file records
+#' them. The coordinates and the extra bytes attributes cannot be written in place. The points of a
+#' laz file cannot be modified in place.
+#'
+#' The operation is not atomic. The data are validated before the file is modified but if writing fails
+#' (e.g. the disk is full) the points already written keep their new attributes,
+#' the other points keep their old attributes and the number of points by return of the header is not
+#' updated. Work on a copy of the file if it must remain consistent.
+#'
+#' @param file character. file path to an existing .las file
+#' @param data data.frame, data.table or list that contains the attributes to write. A column has a
+#' value for each point of the file in the order of the file (e.g. read with \link{read.las} without
+#' filter) or a single value for all the points.
+#' @export
+#' @family rlas
+#' @return void
+#' @examples
+#' lasfile <- system.file("extdata", "example.las", package="rlas")
+#' file    <- file.path(tempdir(), "temp.las")
+#' file.copy(lasfile, file, overwrite = TRUE)
+#'
+#' data <- read.las(file, select = "c")
+#' data$Classification[data$Classification == 1L] <- 2L
+#' write_columns.las(file, data["Classification"])
+write_columns.las = function(file, data)
+{
+  check_file(file)
+  file <- enc2native(normalizePath(file))
+
+  data <- as.list(data)
+  if (length(data) == 0L)
+    return(invisible())
+
+  if (is.null(names(data)) || any(names(data) == ""))
+    stop("The columns must be named.")
+
+  header <- read.lasheader(file)
+  is_valid_attributes(data, header, "stop")
 
-  # Compact ALTREP with values other than 0 will be materialize in C_writer. This need to be handled.
-  C_writer(file, header, data)
-}
\ No newline at end of file
+  C_writer_columns(file, data)
+  return(invisible())
+}
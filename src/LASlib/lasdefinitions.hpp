@@ -720,6 +720,7 @@ public:
     evlrs[i].reserved = 0; // used to be 0xAABB
     // Fix #61
     int len = 0 ; while(*(user_id+len) != '\0' && len < 16) len++;
+    memset(evlrs[i].user_id, 0, 16);
     memcpy(evlrs[i].user_id, user_id, len);
     //strncpy(evlrs[i].user_id, user_id, 16);
     evlrs[i].record_id = record_id;
@@ -730,10 +731,12 @@ public:
     }
     else if (description)
     {
+      memset(evlrs[i].description, 0, 32);
       snprintf(evlrs[i].description, 32, "%.31s", description);
     }
     else
     {
+      memset(evlrs[i].description, 0, 32);
       snprintf(evlrs[i].description, 32, "by LAStools of rapidlasso GmbH");
     }
     if (record_length_after_header)
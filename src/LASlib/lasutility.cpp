@@ -97,6 +97,43 @@ BOOL LASinventory::add(const LASpoint* point)
   return TRUE;
 }
 
+BOOL LASinventory::add(const U8* records, const U32 count, const U32 record_length, const BOOL extended)
+{
+  U32 i;
+  I32 XYZ[3];
+  for (i = 0; i < count; i++)
+  {
+    const U8* record = records + (size_t)i*record_length;
+    memcpy(XYZ, record, 12);
+    extended_number_of_point_records++;
+    if (extended)
+    {
+      extended_number_of_points_by_return[record[14] & 15]++;
+    }
+    else
+    {
+      extended_number_of_points_by_return[record[14] & 7]++;
+    }
+    if (first)
+    {
+      min_X = max_X = XYZ[0];
+      min_Y = max_Y = XYZ[1];
+      min_Z = max_Z = XYZ[2];
+      first = FALSE;
+    }
+    else
+    {
+      if (XYZ[0] < min_X) min_X = XYZ[0];
+      else if (XYZ[0] > max_X) max_X = XYZ[0];
+      if (XYZ[1] < min_Y) min_Y = XYZ[1];
+      else if (XYZ[1] > max_Y) max_Y = XYZ[1];
+      if (XYZ[2] < min_Z) min_Z = XYZ[2];
+      else if (XYZ[2] > max_Z) max_Z = XYZ[2];
+    }
+  }
+  return TRUE;
+}
+
 BOOL LASinventory::update_header(LASheader* header) const
 {
   if (header)
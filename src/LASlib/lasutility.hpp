@@ -50,6 +50,7 @@ public:
   I32 min_Z;
   BOOL init(const LASheader* header);
   BOOL add(const LASpoint* point);
+  BOOL add(const U8* records, const U32 count, const U32 record_length, const BOOL extended);
   BOOL update_header(LASheader* header) const;
   LASinventory();
 private:
@@ -59,6 +59,8 @@ public:
 
   virtual BOOL write_point(const LASpoint* point) = 0;
   virtual void update_inventory(const LASpoint* point) { inventory.add(point); };
+  // writes 'count' consecutive point records in the native byte order. returns FALSE if not supported
+  virtual BOOL write_points(const U8* records, const U32 count) { return FALSE; };
   virtual BOOL chunk() = 0;
 
   virtual BOOL update_header(const LASheader* header, BOOL use_inventory=FALSE, BOOL update_extra_bytes=FALSE) = 0;
@@ -30,14 +30,18 @@
 */
 #include "laswriter_las.hpp"
 
+#include "bytestreamin_file.hpp"
 #include "bytestreamout_nil.hpp"
 #include "bytestreamout_file.hpp"
 #include "bytestreamout_ostream.hpp"
 #include "laswritepoint.hpp"
+#include "lasreadpoint.hpp"
 
 #ifdef _WIN32
 #include <fcntl.h>
 #include <io.h>
+#else
+#include <unistd.h>
 #endif
 
 #include <stdlib.h>
@@ -199,6 +203,8 @@ BOOL LASwriterLAS::open(ByteStreamOut* stream, const LASheader* header, U32 comp
     laszip = new LASzip();
     laszip->setup(point.num_items, point.items, compressor);
     if (chunk_size > -1) laszip->set_chunk_size((U32)chunk_size);
+    // Chunks of variable size are closed with chunk(). COPC files have one chunk per octant.
+    if (compressor && (chunk_size == 0 || header->get_vlr("copc", 1))) laszip->set_chunk_size(U32_MAX);
     if (compressor == LASZIP_COMPRESSOR_NONE) laszip->request_version(0);
     else if (chunk_size == 0 && (point_data_format <= 5)) { REprintf("ERROR: adaptive chunking is depricated for point type %d.\n       only available for new LAS 1.4 point types 6 or higher.\n", point_data_format); return FALSE; }
     else if (requested_version) laszip->request_version(requested_version);
@@ -226,6 +232,12 @@ BOOL LASwriterLAS::open(ByteStreamOut* stream, const LASheader* header, U32 comp
     }
   }
 
+  // records of standard points are written as they are when not compressed
+
+  write_records_raw = (laszip == 0) && IS_LITTLE_ENDIAN();
+  record_length = header->point_data_record_length;
+  if (!record_point.init(&quantizer, point.num_items, point.items, header)) return FALSE;
+
   // save the position where we start writing the header
 
   header_start_position = stream->tell();
@@ -900,17 +912,325 @@ BOOL LASwriterLAS::open(ByteStreamOut* stream, const LASheader* header, U32 comp
   return TRUE;
 }
 
+// the file is cut after the points written. what followed the points is written again at close()
+static BOOL truncate_file(FILE* file, I64 size)
+{
+  if (fflush(file) != 0) return FALSE;
+#ifdef _WIN32
+  return (_chsize_s(_fileno(file), size) == 0);
+#else
+  return (ftruncate(fileno(file), (off_t)size) == 0);
+#endif
+}
+
+BOOL LASwriterLAS::open_append(const char* file_name, const LASheader* header, I32 io_buffer_size)
+{
+  if (file_name == 0)
+  {
+    REprintf("ERROR: file name pointer is zero\n");
+    return FALSE;
+  }
+
+  if (header == 0)
+  {
+    REprintf("ERROR: LASheader pointer is zero\n");
+    return FALSE;
+  }
+
+#ifdef _MSC_VER
+  wchar_t* utf16_file_name = UTF8toUTF16(file_name);
+  file = _wfopen(utf16_file_name, L"r+b");
+  if (file == 0)
+  {
+    REprintf("ERROR: cannot open file '%ws' for append\n", utf16_file_name);
+  }
+  delete[] utf16_file_name;
+#else
+  file = fopen(file_name, "r+b");
+#endif
+
+  if (file == 0)
+  {
+    REprintf("ERROR: cannot open file '%s' for append\n", file_name);
+    return FALSE;
+  }
+
+  if (setvbuf(file, NULL, _IOFBF, io_buffer_size) != 0)
+  {
+    REprintf("WARNING: setvbuf() failed with buffer size %d\n", io_buffer_size);
+  }
+
+  if (IS_LITTLE_ENDIAN())
+    stream = new ByteStreamOutFileLE(file);
+  else
+    stream = new ByteStreamOutFileBE(file);
+
+  // copy scale_and_offset
+
+  quantizer.x_scale_factor = header->x_scale_factor;
+  quantizer.y_scale_factor = header->y_scale_factor;
+  quantizer.z_scale_factor = header->z_scale_factor;
+  quantizer.x_offset = header->x_offset;
+  quantizer.y_offset = header->y_offset;
+  quantizer.z_offset = header->z_offset;
+
+  // the points are written with the items of the file
+
+  LASpoint point;
+  if (header->laszip)
+  {
+    if (!point.init(&quantizer, header->laszip->num_items, header->laszip->items, header)) return FALSE;
+  }
+  else
+  {
+    if (!point.init(&quantizer, header->point_data_format, header->point_data_record_length, header)) return FALSE;
+  }
+
+  writer = new LASwritePoint();
+  if (header->laszip ? !writer->setup(header->laszip->num_items, header->laszip->items, header->laszip) : !writer->setup(point.num_items, point.items))
+  {
+    REprintf("ERROR: point type %d of size %d not supported\n", header->point_data_format, header->point_data_record_length);
+    return FALSE;
+  }
+
+  BOOL compressed = (header->laszip && header->laszip->compressor != LASZIP_COMPRESSOR_NONE);
+  write_records_raw = !compressed && IS_LITTLE_ENDIAN();
+  record_length = header->point_data_record_length;
+  if (!record_point.init(&quantizer, point.num_items, point.items, header)) return FALSE;
+
+  header_start_position = 0;
+  writing_las_1_4 = (header->version_minor >= 4);
+  writing_new_point_type = writing_las_1_4 && (header->point_data_format >= 6);
+  if (writing_las_1_4)
+  {
+    start_of_first_extended_variable_length_record = header->start_of_first_extended_variable_length_record;
+    number_of_extended_variable_length_records = header->number_of_extended_variable_length_records;
+    evlrs = header->evlrs;
+  }
+
+  // the points of the file are counted as written. the inventory starts from the header so that
+  // update_header() with the inventory gives the counts and the bounding box of all the points
+
+  npoints = (header->number_of_point_records ? header->number_of_point_records : header->extended_number_of_point_records);
+  p_count = npoints;
+  if (npoints) inventory.init(header);
+
+  ByteStreamIn* in;
+  if (IS_LITTLE_ENDIAN())
+    in = new ByteStreamInFileLE(file);
+  else
+    in = new ByteStreamInFileBE(file);
+
+  BOOL success = init_append(in, header);
+  delete in;
+
+  if (!success)
+  {
+    abandon_append();
+    return FALSE;
+  }
+
+  truncate_pending = TRUE;
+  return TRUE;
+}
+
+// the new points overwrite the end of the file from the position of the stream. the end of the
+// file is cut when the writer is closed, before the header is updated and the stream returns to
+// the end of the file
+BOOL LASwriterLAS::truncate_append()
+{
+  if (!truncate_pending) return TRUE;
+  truncate_pending = FALSE;
+
+  if (!truncate_file(file, stream->tell()))
+  {
+    REprintf("ERROR: cannot cut the end of the file\n");
+    return FALSE;
+  }
+  return TRUE;
+}
+
+// closes the file without writing anything when the points cannot be appended
+void LASwriterLAS::abandon_append()
+{
+  if (writer)
+  {
+    delete writer;
+    writer = 0;
+  }
+  if (stream)
+  {
+    delete stream;
+    stream = 0;
+  }
+  if (file)
+  {
+    fclose(file);
+    file = 0;
+  }
+}
+
+// positions the stream after the points of the file and initializes the point writer. the chunk
+// table of a LAZ file is read and its last chunk, when not full, is decoded to be encoded again
+// with the new points. the chunk table is rewritten after the new chunks by close()
+BOOL LASwriterLAS::init_append(ByteStreamIn* instream, const LASheader* header)
+{
+  // LASreaderLAS removes the LASzip VLR from the header. the offset is read in the file
+
+  U32 offset_to_point_data;
+  try
+  {
+    instream->seek(96);
+    instream->get32bitsLE((U8*)&offset_to_point_data);
+  }
+  catch (...)
+  {
+    REprintf("ERROR: reading offset_to_point_data\n");
+    return FALSE;
+  }
+
+  if ((header->laszip == 0) || (header->laszip->compressor == LASZIP_COMPRESSOR_NONE))
+  {
+    if (!stream->seek(offset_to_point_data + npoints*record_length))
+    {
+      REprintf("ERROR: cannot seek to the end of the points\n");
+      return FALSE;
+    }
+    return writer->init(stream);
+  }
+
+  if (header->laszip->compressor == LASZIP_COMPRESSOR_POINTWISE)
+  {
+    REprintf("ERROR: cannot append points to a LAZ file without chunks\n");
+    return FALSE;
+  }
+
+  LASreadPoint reader;
+  if (!reader.setup(header->laszip->num_items, header->laszip->items, header->laszip)) return FALSE;
+  if (!instream->seek(offset_to_point_data)) return FALSE;
+  if (!reader.init(instream)) return FALSE;
+
+  U32 number_chunks;
+  const I64* chunk_starts;
+  const U32* chunk_totals;
+  if (!reader.get_chunk_table(&number_chunks, &chunk_starts, &chunk_totals))
+  {
+    REprintf("ERROR: cannot read the chunk table of the LAZ file\n");
+    return FALSE;
+  }
+
+  // a chunk of fixed size that is not full is encoded again with the new points
+
+  U32 chunk_size = header->laszip->chunk_size;
+  U32 keep = number_chunks;
+  U32 carried = 0;
+  if (chunk_totals)
+  {
+    if (chunk_totals[number_chunks] != npoints)
+    {
+      REprintf("ERROR: the chunk table does not match the number of points\n");
+      return FALSE;
+    }
+  }
+  else
+  {
+    if ((npoints + chunk_size - 1) / chunk_size != number_chunks)
+    {
+      REprintf("ERROR: the chunk table does not match the number of points\n");
+      return FALSE;
+    }
+    if (npoints % chunk_size)
+    {
+      keep = number_chunks - 1;
+      carried = (U32)(npoints % chunk_size);
+      if ((I64)keep*chunk_size + carried > U32_MAX)
+      {
+        REprintf("ERROR: cannot append points to a LAZ file of more than %u points\n", U32_MAX);
+        return FALSE;
+      }
+    }
+  }
+
+  U8* carried_records = 0;
+  if (carried)
+  {
+    carried_records = new U8[(size_t)carried*record_length];
+    BOOL read = reader.seek(0, keep*chunk_size);
+    for (U32 i = 0; read && (i < carried); i++)
+    {
+      read = reader.read(record_point.point);
+      record_point.copy_to(carried_records + (size_t)i*record_length);
+    }
+    if (!read)
+    {
+      REprintf("ERROR: reading the points of the last chunk\n");
+      delete [] carried_records;
+      return FALSE;
+    }
+  }
+  reader.done();
+
+  U32* sizes = new U32[keep + 1];
+  U32* bytes = new U32[keep + 1];
+  for (U32 i = 0; i < keep; i++)
+  {
+    sizes[i] = (chunk_totals ? chunk_totals[i+1] - chunk_totals[i] : chunk_size);
+    bytes[i] = (U32)(chunk_starts[i+1] - chunk_starts[i]);
+  }
+
+  BOOL success = stream->seek(chunk_starts[keep]) && writer->init_append(stream, offset_to_point_data, keep, sizes, bytes);
+  delete [] sizes;
+  delete [] bytes;
+
+  for (U32 i = 0; success && (i < carried); i++)
+  {
+    record_point.copy_from(carried_records + (size_t)i*record_length);
+    success = writer->write(record_point.point);
+  }
+  if (carried_records) delete [] carried_records;
+
+  if (!success)
+  {
+    REprintf("ERROR: cannot continue the chunks of the LAZ file\n");
+  }
+  return success;
+}
+
 BOOL LASwriterLAS::write_point(const LASpoint* point)
 {
   p_count++;
   return writer->write(point->point);
 }
 
+BOOL LASwriterLAS::write_points(const U8* records, const U32 count)
+{
+  if (write_records_raw)
+  {
+    if (!stream->putBytes(records, (U32)count*record_length)) return FALSE;
+    p_count += count;
+    return TRUE;
+  }
+
+  U32 i;
+  for (i = 0; i < count; i++)
+  {
+    record_point.copy_from(records + (size_t)i*record_length);
+    p_count++;
+    if (!writer->write(record_point.point)) return FALSE;
+  }
+  return TRUE;
+}
+
 BOOL LASwriterLAS::chunk()
 {
   return writer->chunk();
 }
 
+BOOL LASwriterLAS::get_chunks(I64* first_chunk_position, U32* number_chunks, const U32** chunk_bytes)
+{
+  return writer->get_chunks(first_chunk_position, number_chunks, chunk_bytes);
+}
+
 BOOL LASwriterLAS::update_header(const LASheader* header, BOOL use_inventory, BOOL update_extra_bytes)
 {
   I32 i;
@@ -929,6 +1249,7 @@ BOOL LASwriterLAS::update_header(const LASheader* header, BOOL use_inventory, BO
     REprintf("WARNING: stream not seekable. cannot update header.\n");
     return FALSE;
   }
+  if (!truncate_append()) return FALSE;
   if (use_inventory)
   {
     U32 number;
@@ -1244,6 +1565,8 @@ I64 LASwriterLAS::close(BOOL update_npoints)
     }
   }
 
+  if (stream && !truncate_append()) return FALSE;
+
   if (writer)
   {
     writer->done();
@@ -1410,12 +1733,15 @@ LASwriterLAS::LASwriterLAS()
   stream = 0;
   delete_stream = TRUE;
   writer = 0;
+  write_records_raw = FALSE;
+  record_length = 0;
   writing_las_1_4 = FALSE;
   writing_new_point_type = FALSE;
   // for delayed write of EVLRs
   start_of_first_extended_variable_length_record = 0;
   number_of_extended_variable_length_records = 0;
   evlrs = 0;
+  truncate_pending = FALSE;
 }
 
 LASwriterLAS::~LASwriterLAS()
@@ -53,6 +53,7 @@
 using namespace std;
 #endif
 
+class ByteStreamIn;
 class ByteStreamOut;
 class LASwritePoint;
 
@@ -68,9 +69,15 @@ public:
   BOOL open(FILE* file, const LASheader* header, U32 compressor=LASZIP_COMPRESSOR_NONE, I32 requested_version=0, I32 chunk_size=50000);
   BOOL open(ostream& ostream, const LASheader* header, U32 compressor=LASZIP_COMPRESSOR_NONE, I32 requested_version=0, I32 chunk_size=50000);
   BOOL open(ByteStreamOut* stream, const LASheader* header, U32 compressor=LASZIP_COMPRESSOR_NONE, I32 requested_version=0, I32 chunk_size=50000);
+  // writes points after the points of an existing LAS or LAZ file. the header is the header of the
+  // file read by LASreaderLAS and must stay valid until close() that rewrites the EVLRs. the file
+  // is left untouched when it fails and is cut after the new points by update_header() or close()
+  BOOL open_append(const char* file_name, const LASheader* header, I32 io_buffer_size=LAS_TOOLS_IO_OBUFFER_SIZE);
 
   BOOL write_point(const LASpoint* point);
+  BOOL write_points(const U8* records, const U32 count);
   BOOL chunk();
+  BOOL get_chunks(I64* first_chunk_position, U32* number_chunks, const U32** chunk_bytes);
 
   BOOL update_header(const LASheader* header, BOOL use_inventory=FALSE, BOOL update_extra_bytes=FALSE);
   I64 close(BOOL update_npoints=TRUE);
@@ -80,10 +87,17 @@ public:
   ~LASwriterLAS();
 
 private:
+  BOOL init_append(ByteStreamIn* instream, const LASheader* header);
+  BOOL truncate_append();
+  void abandon_append();
   FILE* file;
   ByteStreamOut* stream;
   BOOL delete_stream;
   LASwritePoint* writer;
+  // for writing batches of point records
+  BOOL write_records_raw;
+  U16 record_length;
+  LASpoint record_point;
   I64 header_start_position;
   BOOL writing_las_1_4;
   BOOL writing_new_point_type;
@@ -91,6 +105,8 @@ private:
   I64 start_of_first_extended_variable_length_record;
   U32 number_of_extended_variable_length_records;
   const LASevlr* evlrs;
+  // what followed the points of an appended file is cut when the writer is closed
+  BOOL truncate_pending;
 };
 
 #endif
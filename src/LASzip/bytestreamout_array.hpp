@@ -62,6 +62,8 @@ public:
   inline const U8* getData() const { return data; };
   inline U8* takeData() { U8* d = data; data = 0; alloc = 0; size = 0; curr = 0; return d; };
 protected:
+/* grow the buffer geometrically to hold at least min bytes  */
+  BOOL grow(I64 min);
   U8* data;
   I64 alloc;
   I64 size;
@@ -110,7 +112,7 @@ private:
 
 inline ByteStreamOutArray::ByteStreamOutArray(I64 alloc)
 {
-  this->data = (U8*)malloc((U32)alloc);
+  this->data = (U8*)malloc((size_t)alloc);
   this->alloc = alloc;
   this->size = 0;
   this->curr = 0;
@@ -120,12 +122,7 @@ inline BOOL ByteStreamOutArray::putByte(U8 byte)
 {
   if (curr == alloc)
   {
-    alloc += 4096;
-    data = (U8*)realloc(data, (U32)alloc);
-    if (data == 0)
-    {
-      return FALSE;
-    }
+    if (!grow(curr+1)) return FALSE;
   }
   data[curr] = byte;
   if (curr == size) size++;
@@ -137,12 +134,7 @@ inline BOOL ByteStreamOutArray::putBytes(const U8* bytes, U32 num_bytes)
 {
   if ((curr+num_bytes) > alloc)
   {
-    alloc += (4096+num_bytes);
-    data = (U8*)realloc(data, (U32)alloc);
-    if (data == 0)
-    {
-      return FALSE;
-    }
+    if (!grow(curr+num_bytes)) return FALSE;
   }
   memcpy((void*)(data+curr), bytes, num_bytes);
   curr += num_bytes;
@@ -150,6 +142,22 @@ inline BOOL ByteStreamOutArray::putBytes(const U8* bytes, U32 num_bytes)
   return TRUE;
 }
 
+inline BOOL ByteStreamOutArray::grow(I64 min)
+{
+  // doubling keeps the amortized cost of appends constant, which matters
+  // when a whole LAS/LAZ file of several GB is written into memory
+  I64 new_alloc = (alloc < 4096 ? 4096 : alloc);
+  while (new_alloc < min) new_alloc *= 2;
+  U8* new_data = (U8*)realloc(data, (size_t)new_alloc);
+  if (new_data == 0)
+  {
+    return FALSE;
+  }
+  data = new_data;
+  alloc = new_alloc;
+  return TRUE;
+}
+
 inline BOOL ByteStreamOutArray::isSeekable() const
 {
   return TRUE;
@@ -568,6 +568,25 @@ BOOL LASreadPoint::done()
   return TRUE;
 }
 
+BOOL LASreadPoint::get_chunk_table(U32* number_chunks, const I64** chunk_starts, const U32** chunk_totals)
+{
+  if (dec == 0 || !instream->isSeekable()) return FALSE;
+  if (point_start == 0)
+  {
+    if (!init_dec()) return FALSE;
+    chunk_count = 0;
+  }
+  // the table is incomplete when the compressor was interrupted
+  if (this->chunk_starts == 0 || this->number_chunks == U32_MAX || tabled_chunks != this->number_chunks + 1)
+  {
+    return FALSE;
+  }
+  *number_chunks = this->number_chunks;
+  *chunk_starts = this->chunk_starts;
+  *chunk_totals = this->chunk_totals;
+  return TRUE;
+}
+
 BOOL LASreadPoint::init_dec()
 {
   // maybe read chunk table (only if chunking enabled)
@@ -68,6 +68,11 @@ public:
   BOOL check_end();
   BOOL done();
 
+  // reads the chunk table if not read yet and gives the number of chunks, the start of each chunk
+  // followed by the start of the chunk table and, for variable chunks, the cumulative number of
+  // points before each chunk. used to append points to a LAZ file
+  BOOL get_chunk_table(U32* number_chunks, const I64** chunk_starts, const U32** chunk_totals);
+
   inline const CHAR* error() const { return last_error; };
   inline const CHAR* warning() const { return last_warning; };
 
@@ -37,11 +37,25 @@
 #include "laswriteitemcompressed_v2.hpp"
 #include "laswriteitemcompressed_v3.hpp"
 #include "laswriteitemcompressed_v4.hpp"
+#include "bytestreamout_array.hpp"
+#include "laspoint.hpp"
 
+#include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+U32 LASwritePoint::max_threads = 1;
+
+void LASwritePoint::set_max_threads(U32 max_threads)
+{
+  LASwritePoint::max_threads = (max_threads ? max_threads : 1);
+}
+
 LASwritePoint::LASwritePoint()
 {
   outstream = 0;
@@ -60,6 +74,19 @@ LASwritePoint::LASwritePoint()
   chunk_bytes = 0;
   chunk_table_start_position = 0;
   chunk_start_position = 0;
+  // used for parallel compression
+  num_threads = 1;
+  is_worker = FALSE;
+  workers = 0;
+  item_offsets = 0;
+  item_bytes = 0;
+  point_bytes = 0;
+  batch = 0;
+  batch_points = 0;
+  batch_alloced = 0;
+  batch_chunk_ends = 0;
+  batch_chunks = 0;
+  chunk_point = 0;
 }
 
 BOOL LASwritePoint::setup(const U32 num_items, const LASitem* items, const LASzip* laszip)
@@ -251,6 +278,96 @@ BOOL LASwritePoint::setup(const U32 num_items, const LASitem* items, const LASzi
       number_chunks = U32_MAX;
     }
   }
+
+  // chunks are independent and can be encoded in parallel
+  if (is_worker)
+  {
+    chunk_point = new const U8*[num_writers];
+  }
+  else if (enc && number_chunks == U32_MAX)
+  {
+#ifdef _OPENMP
+    num_threads = max_threads;
+    if (num_threads > (U32)omp_get_max_threads()) num_threads = (U32)omp_get_max_threads();
+#endif
+    if (num_threads > 1)
+    {
+      return setup_parallel(num_items, items, laszip);
+    }
+  }
+  return TRUE;
+}
+
+// size of the items in the memory of a LASpoint. this is what the raw and the
+// compressed writers read and this is not always the size of the item on disk.
+static U32 item_memory_size(const LASitem& item)
+{
+  switch (item.type)
+  {
+  case LASitem::POINT10:
+    return 20;
+  case LASitem::POINT14:
+    // from X to the RGB values (the LASpoint14 struct of the compressors)
+    return (U32)(offsetof(LASpoint, rgb) + 4*sizeof(U16) - offsetof(LASpoint, X));
+  case LASitem::GPSTIME11:
+    return 8;
+  case LASitem::RGB12:
+  case LASitem::RGB14:
+    return 6;
+  case LASitem::RGBNIR14:
+    return 8;
+  case LASitem::WAVEPACKET13:
+  case LASitem::WAVEPACKET14:
+    return 29;
+  case LASitem::BYTE:
+  case LASitem::BYTE14:
+    return item.size;
+  default:
+    return 0;
+  }
+}
+
+BOOL LASwritePoint::setup_parallel(const U32 num_items, const LASitem* items, const LASzip* laszip)
+{
+  U32 i;
+
+  item_offsets = new U32[num_writers];
+  item_bytes = new U32[num_writers];
+  point_bytes = 0;
+  for (i = 0; i < num_writers; i++)
+  {
+    item_bytes[i] = item_memory_size(items[i]);
+    if (item_bytes[i] == 0)
+    {
+      // unknown item. compress sequentially
+      num_threads = 1;
+      return TRUE;
+    }
+    item_offsets[i] = point_bytes;
+    // the items are read through pointers to their types (F64 gps time). keep them aligned
+    point_bytes += (item_bytes[i] + 7) & ~7u;
+  }
+
+  // the buffer of variable chunks starts with default chunks and grows as needed
+  batch_alloced = num_threads*(chunk_size != U32_MAX ? chunk_size : LASZIP_CHUNK_SIZE_DEFAULT);
+  batch = (U8*)malloc((size_t)batch_alloced*point_bytes);
+  if (batch == 0)
+  {
+    // not enough memory for the buffers. compress sequentially
+    num_threads = 1;
+    return TRUE;
+  }
+  batch_points = 0;
+  batch_chunk_ends = new U32[num_threads];
+  batch_chunks = 0;
+
+  workers = new LASwritePoint*[num_threads];
+  for (i = 0; i < num_threads; i++)
+  {
+    workers[i] = new LASwritePoint();
+    workers[i]->is_worker = TRUE;
+    if (!workers[i]->setup(num_items, items, laszip)) return FALSE;
+  }
   return TRUE;
 }
 
@@ -293,33 +410,74 @@ BOOL LASwritePoint::init(ByteStreamOut* outstream)
   return TRUE;
 }
 
+BOOL LASwritePoint::init_append(ByteStreamOut* outstream, I64 chunk_table_start_position, U32 number_chunks, const U32* chunk_sizes, const U32* chunk_bytes)
+{
+  U32 i;
+
+  if (!outstream || !outstream->isSeekable()) return FALSE;
+  // only chunked compressed points have a chunk table
+  if (enc == 0 || this->number_chunks != U32_MAX) return FALSE;
+  this->outstream = outstream;
+
+  alloced_chunks = 1024;
+  while (alloced_chunks < number_chunks) alloced_chunks *= 2;
+  if (chunk_size == U32_MAX)
+  {
+    this->chunk_sizes = (U32*)malloc(sizeof(U32)*alloced_chunks);
+    if (this->chunk_sizes == 0) return FALSE;
+    for (i = 0; i < number_chunks; i++) this->chunk_sizes[i] = chunk_sizes[i];
+  }
+  this->chunk_bytes = (U32*)malloc(sizeof(U32)*alloced_chunks);
+  if (this->chunk_bytes == 0) return FALSE;
+  for (i = 0; i < number_chunks; i++) this->chunk_bytes[i] = chunk_bytes[i];
+  this->number_chunks = number_chunks;
+
+  this->chunk_table_start_position = chunk_table_start_position;
+  chunk_start_position = outstream->tell();
+  chunk_count = 0;
+
+  for (i = 0; i < num_writers; i++)
+  {
+    ((LASwriteItemRaw*)(writers_raw[i]))->init(outstream);
+  }
+  writers = 0;
+
+  return TRUE;
+}
+
 BOOL LASwritePoint::write(const U8 * const * point)
 {
   U32 i;
-  U32 context = 0;
+
+  if (workers)
+  {
+    if (batch_points == batch_alloced)
+    {
+      // only happens with variable chunks
+      U8* grown = (U8*)realloc(batch, (size_t)2*batch_alloced*point_bytes);
+      if (grown == 0) return FALSE;
+      batch = grown;
+      batch_alloced *= 2;
+    }
+    // buffer the point. the chunks are encoded when all the workers have one
+    U8* buffered = batch + (size_t)batch_points*point_bytes;
+    for (i = 0; i < num_writers; i++)
+    {
+      memcpy(buffered + item_offsets[i], point[i], item_bytes[i]);
+    }
+    batch_points++;
+    if (chunk_size != U32_MAX && batch_points == num_threads*chunk_size)
+    {
+      return write_batch();
+    }
+    return TRUE;
+  }
 
   if (chunk_count == chunk_size)
   {
     if (enc)
     {
-      if (layered_las14_compression)
-      {
-        // write how many points are in the chunk
-        outstream->put32bitsLE((U8*)&chunk_count);
-        // write all layers 
-        for (i = 0; i < num_writers; i++)
-        {
-          ((LASwriteItemCompressed*)writers[i])->chunk_sizes();
-        }
-        for (i = 0; i < num_writers; i++)
-        {
-          ((LASwriteItemCompressed*)writers[i])->chunk_bytes();
-        }
-      }
-      else
-      {
-        enc->done();
-      }
+      finish_chunk();
       add_chunk_to_table();
       init(outstream);
     }
@@ -332,6 +490,14 @@ BOOL LASwritePoint::write(const U8 * const * point)
   }
   chunk_count++;
 
+  return encode(point);
+}
+
+BOOL LASwritePoint::encode(const U8 * const * point)
+{
+  U32 i;
+  U32 context = 0;
+
   if (writers)
   {
     for (i = 0; i < num_writers; i++)
@@ -352,12 +518,8 @@ BOOL LASwritePoint::write(const U8 * const * point)
   return TRUE;
 }
 
-BOOL LASwritePoint::chunk()
+BOOL LASwritePoint::finish_chunk()
 {
-  if (chunk_start_position == 0 || chunk_size != U32_MAX)
-  {
-    return FALSE;
-  }
   if (layered_las14_compression)
   {
     U32 i;
@@ -377,6 +539,115 @@ BOOL LASwritePoint::chunk()
   {
     enc->done();
   }
+  return TRUE;
+}
+
+// encodes a chunk of buffered points exactly like write() would do it
+BOOL LASwritePoint::encode_chunk(ByteStreamOut* outstream, const U8* points, U32 count, const U32* item_offsets, U32 point_bytes)
+{
+  U32 i, j;
+
+  this->outstream = outstream;
+  for (i = 0; i < num_writers; i++)
+  {
+    ((LASwriteItemRaw*)(writers_raw[i]))->init(outstream);
+  }
+  writers = 0;
+  chunk_count = 0;
+
+  for (j = 0; j < count; j++)
+  {
+    for (i = 0; i < num_writers; i++)
+    {
+      chunk_point[i] = points + (size_t)j*point_bytes + item_offsets[i];
+    }
+    chunk_count++;
+    if (!encode(chunk_point)) return FALSE;
+  }
+
+  return finish_chunk();
+}
+
+// encodes the buffered chunks in parallel and writes them in order. the points
+// of a variable chunk that is not closed yet stay in the buffer
+BOOL LASwritePoint::write_batch()
+{
+  I32 t;
+  U32 first;
+  BOOL success = TRUE;
+
+  if (chunk_size != U32_MAX)
+  {
+    batch_chunks = 0;
+    for (first = 0; first < batch_points; first += chunk_size)
+    {
+      batch_chunk_ends[batch_chunks++] = (batch_points - first < chunk_size ? batch_points : first + chunk_size);
+    }
+  }
+
+  I32 num_chunks = (I32)batch_chunks;
+  ByteStreamOutArray** buffers = new ByteStreamOutArray*[num_chunks];
+
+  #pragma omp parallel for num_threads(num_threads) schedule(static, 1)
+  for (t = 0; t < num_chunks; t++)
+  {
+    U32 first = (t ? batch_chunk_ends[t-1] : 0);
+    U32 count = batch_chunk_ends[t] - first;
+    if (IS_LITTLE_ENDIAN())
+      buffers[t] = new ByteStreamOutArrayLE((I64)count*point_bytes/4 + 4096);
+    else
+      buffers[t] = new ByteStreamOutArrayBE((I64)count*point_bytes/4 + 4096);
+    if (!workers[t]->encode_chunk(buffers[t], batch + (size_t)first*point_bytes, count, item_offsets, point_bytes))
+    {
+      #pragma omp atomic write
+      success = FALSE;
+    }
+  }
+
+  for (t = 0; t < num_chunks; t++)
+  {
+    if (success)
+    {
+      chunk_count = batch_chunk_ends[t] - (t ? batch_chunk_ends[t-1] : 0);
+      if (!outstream->putBytes(buffers[t]->getData(), (U32)buffers[t]->getSize())) success = FALSE;
+      else add_chunk_to_table();
+    }
+    delete buffers[t];
+  }
+  delete [] buffers;
+
+  first = (num_chunks ? batch_chunk_ends[num_chunks-1] : 0);
+  if (first < batch_points)
+  {
+    memmove(batch, batch + (size_t)first*point_bytes, (size_t)(batch_points - first)*point_bytes);
+  }
+  batch_points -= first;
+  batch_chunks = 0;
+  chunk_count = 0;
+  return success;
+}
+
+BOOL LASwritePoint::chunk()
+{
+  if (chunk_start_position == 0 || chunk_size != U32_MAX)
+  {
+    return FALSE;
+  }
+  if (workers)
+  {
+    // close the chunk at the last buffered point
+    if (batch_points == (batch_chunks ? batch_chunk_ends[batch_chunks-1] : 0))
+    {
+      return FALSE;
+    }
+    batch_chunk_ends[batch_chunks++] = batch_points;
+    if (batch_chunks == num_threads)
+    {
+      return write_batch();
+    }
+    return TRUE;
+  }
+  finish_chunk();
   add_chunk_to_table();
   init(outstream);
   chunk_count = 0;
@@ -385,27 +656,19 @@ BOOL LASwritePoint::chunk()
 
 BOOL LASwritePoint::done()
 {
-  if (writers == writers_compressed)
+  if (workers && batch_points)
   {
-    if (layered_las14_compression)
+    // the last variable chunk is closed by done()
+    if (chunk_size == U32_MAX && batch_points != (batch_chunks ? batch_chunk_ends[batch_chunks-1] : 0))
     {
-      U32 i;
-      // write how many points are in the chunk
-      outstream->put32bitsLE((U8*)&chunk_count);
-      // write all layers 
-      for (i = 0; i < num_writers; i++)
-      {
-        ((LASwriteItemCompressed*)writers[i])->chunk_sizes();
-      }
-      for (i = 0; i < num_writers; i++)
-      {
-        ((LASwriteItemCompressed*)writers[i])->chunk_bytes();
-      }
-    }
-    else
-    {
-      enc->done();
+      batch_chunk_ends[batch_chunks++] = batch_points;
     }
+    if (!write_batch()) return FALSE;
+  }
+
+  if (writers == writers_compressed)
+  {
+    finish_chunk();
     if (chunk_start_position)
     {
       if (chunk_count) add_chunk_to_table();
@@ -423,6 +686,22 @@ BOOL LASwritePoint::done()
   return TRUE;
 }
 
+BOOL LASwritePoint::get_chunks(I64* first_chunk_position, U32* number_chunks, const U32** chunk_bytes)
+{
+  if (chunk_table_start_position == 0 || chunk_table_start_position == -1)
+  {
+    return FALSE;
+  }
+  if (workers && batch_chunks)
+  {
+    if (!write_batch()) return FALSE;
+  }
+  *first_chunk_position = chunk_table_start_position + 8;
+  *number_chunks = this->number_chunks;
+  *chunk_bytes = this->chunk_bytes;
+  return TRUE;
+}
+
 BOOL LASwritePoint::add_chunk_to_table()
 {
   if (number_chunks == alloced_chunks)
@@ -525,5 +804,20 @@ LASwritePoint::~LASwritePoint()
     delete enc;
   }
 
+  if (chunk_sizes) free(chunk_sizes);
   if (chunk_bytes) free(chunk_bytes);
+
+  if (workers)
+  {
+    for (i = 0; i < num_threads; i++)
+    {
+      delete workers[i];
+    }
+    delete [] workers;
+  }
+  if (item_offsets) delete [] item_offsets;
+  if (item_bytes) delete [] item_bytes;
+  if (batch) free(batch);
+  if (batch_chunk_ends) delete [] batch_chunk_ends;
+  if (chunk_point) delete [] chunk_point;
 }
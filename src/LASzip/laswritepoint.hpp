@@ -59,11 +59,24 @@ public:
   BOOL setup(const U32 num_items, const LASitem* items, const LASzip* laszip=0);
 
   BOOL init(ByteStreamOut* outstream);
+  // continues the chunks of an existing LAZ file. the chunks given are kept, the next chunk starts at
+  // the current position of the stream and done() rewrites the chunk table after the last chunk
+  BOOL init_append(ByteStreamOut* outstream, I64 chunk_table_start_position, U32 number_chunks, const U32* chunk_sizes, const U32* chunk_bytes);
   BOOL write(const U8 * const * point);
   BOOL chunk();
   BOOL done();
 
+  // encodes and writes the buffered chunks and gives the position of the first chunk and the
+  // number of bytes of each chunk written so far. used to index the chunks of a COPC file
+  BOOL get_chunks(I64* first_chunk_position, U32* number_chunks, const U32** chunk_bytes);
+
+  // maximum number of threads that encode the chunks of the writers set up afterwards (default 1)
+  static void set_max_threads(U32 max_threads);
+
 private:
+  static U32 max_threads;
+  BOOL encode(const U8 * const * point);
+  BOOL finish_chunk();
   ByteStreamOut* outstream;
   U32 num_writers;
   LASwriteItem** writers;
@@ -82,6 +95,24 @@ private:
   I64 chunk_table_start_position;
   BOOL add_chunk_to_table();
   BOOL write_chunk_table();
+  // used for parallel compression: full chunks of points are buffered and
+  // each chunk is encoded by a worker into its own memory buffer. variable
+  // chunks are buffered until chunk() closed one chunk per worker
+  U32 num_threads;
+  BOOL is_worker;
+  LASwritePoint** workers;
+  U32* item_offsets;
+  U32* item_bytes;
+  U32 point_bytes;
+  U8* batch;
+  U32 batch_points;
+  U32 batch_alloced;
+  U32* batch_chunk_ends;
+  U32 batch_chunks;
+  const U8** chunk_point;
+  BOOL setup_parallel(const U32 num_items, const LASitem* items, const LASzip* laszip);
+  BOOL encode_chunk(ByteStreamOut* outstream, const U8* points, U32 count, const U32* item_offsets, U32 point_bytes);
+  BOOL write_batch();
 };
 
 #endif
@@ -10,13 +10,37 @@ Rcpp::Rostream<true>&  Rcpp::Rcout = Rcpp::Rcpp_cout_get();
 Rcpp::Rostream<false>& Rcpp::Rcerr = Rcpp::Rcpp_cerr_get();
 #endif
 
+// R_block_compressed_size
+double R_block_compressed_size(SEXP x);
+RcppExport SEXP _rlas_R_block_compressed_size(SEXP xSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type x(xSEXP);
+    rcpp_result_gen = Rcpp::wrap(R_block_compressed_size(x));
+    return rcpp_result_gen;
+END_RCPP
+}
+// R_block_compress
+SEXP R_block_compress(SEXP x, double scale, double offset);
+RcppExport SEXP _rlas_R_block_compress(SEXP xSEXP, SEXP scaleSEXP, SEXP offsetSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type x(xSEXP);
+    Rcpp::traits::input_parameter< double >::type scale(scaleSEXP);
+    Rcpp::traits::input_parameter< double >::type offset(offsetSEXP);
+    rcpp_result_gen = Rcpp::wrap(R_block_compress(x, scale, offset));
+    return rcpp_result_gen;
+END_RCPP
+}
 // R_compact_rep
-SEXP R_compact_rep(int n, SEXP v);
+SEXP R_compact_rep(R_xlen_t n, SEXP v);
 RcppExport SEXP _rlas_R_compact_rep(SEXP nSEXP, SEXP vSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< int >::type n(nSEXP);
+    Rcpp::traits::input_parameter< R_xlen_t >::type n(nSEXP);
     Rcpp::traits::input_parameter< SEXP >::type v(vSEXP);
     rcpp_result_gen = Rcpp::wrap(R_compact_rep(n, v));
     return rcpp_result_gen;
@@ -55,6 +79,51 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// C_columnar_attach
+SEXP C_columnar_attach(SEXP file);
+RcppExport SEXP _rlas_C_columnar_attach(SEXP fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type file(fileSEXP);
+    rcpp_result_gen = Rcpp::wrap(C_columnar_attach(file));
+    return rcpp_result_gen;
+END_RCPP
+}
+// C_columnar_key
+SEXP C_columnar_key(SEXP file);
+RcppExport SEXP _rlas_C_columnar_key(SEXP fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type file(fileSEXP);
+    rcpp_result_gen = Rcpp::wrap(C_columnar_key(file));
+    return rcpp_result_gen;
+END_RCPP
+}
+// R_narrow_size
+double R_narrow_size(SEXP x);
+RcppExport SEXP _rlas_R_narrow_size(SEXP xSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type x(xSEXP);
+    rcpp_result_gen = Rcpp::wrap(R_narrow_size(x));
+    return rcpp_result_gen;
+END_RCPP
+}
+// R_narrow_integer
+SEXP R_narrow_integer(SEXP x, int bits);
+RcppExport SEXP _rlas_R_narrow_integer(SEXP xSEXP, SEXP bitsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type x(xSEXP);
+    Rcpp::traits::input_parameter< int >::type bits(bitsSEXP);
+    rcpp_result_gen = Rcpp::wrap(R_narrow_integer(x, bits));
+    return rcpp_result_gen;
+END_RCPP
+}
 // fast_countequal
 int fast_countequal(IntegerVector x, int t);
 RcppExport SEXP _rlas_fast_countequal(SEXP xSEXP, SEXP tSEXP) {
@@ -102,9 +171,34 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// fast_header_inventory
+List fast_header_inventory(NumericVector X, NumericVector Y, NumericVector Z, IntegerVector ReturnNumber);
+RcppExport SEXP _rlas_fast_header_inventory(SEXP XSEXP, SEXP YSEXP, SEXP ZSEXP, SEXP ReturnNumberSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericVector >::type X(XSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type Y(YSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type Z(ZSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type ReturnNumber(ReturnNumberSEXP);
+    rcpp_result_gen = Rcpp::wrap(fast_header_inventory(X, Y, Z, ReturnNumber));
+    return rcpp_result_gen;
+END_RCPP
+}
+// fast_hash
+std::string fast_hash(std::string x);
+RcppExport SEXP _rlas_fast_hash(SEXP xSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type x(xSEXP);
+    rcpp_result_gen = Rcpp::wrap(fast_hash(x));
+    return rcpp_result_gen;
+END_RCPP
+}
 // C_reader
-List C_reader(CharacterVector ifiles, CharacterVector ofile, CharacterVector select, CharacterVector filter, Rcpp::List polygons);
-RcppExport SEXP _rlas_C_reader(SEXP ifilesSEXP, SEXP ofileSEXP, SEXP selectSEXP, SEXP filterSEXP, SEXP polygonsSEXP) {
+List C_reader(CharacterVector ifiles, CharacterVector ofile, CharacterVector select, CharacterVector filter, CharacterVector sort, Rcpp::List polygons);
+RcppExport SEXP _rlas_C_reader(SEXP ifilesSEXP, SEXP ofileSEXP, SEXP selectSEXP, SEXP filterSEXP, SEXP sortSEXP, SEXP polygonsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -112,8 +206,71 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< CharacterVector >::type ofile(ofileSEXP);
     Rcpp::traits::input_parameter< CharacterVector >::type select(selectSEXP);
     Rcpp::traits::input_parameter< CharacterVector >::type filter(filterSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type sort(sortSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type polygons(polygonsSEXP);
+    rcpp_result_gen = Rcpp::wrap(C_reader(ifiles, ofile, select, filter, sort, polygons));
+    return rcpp_result_gen;
+END_RCPP
+}
+// C_reader_arrow
+List C_reader_arrow(CharacterVector ifiles, CharacterVector select, CharacterVector filter, CharacterVector sort, Rcpp::List polygons);
+RcppExport SEXP _rlas_C_reader_arrow(SEXP ifilesSEXP, SEXP selectSEXP, SEXP filterSEXP, SEXP sortSEXP, SEXP polygonsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< CharacterVector >::type ifiles(ifilesSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type select(selectSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type filter(filterSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type sort(sortSEXP);
     Rcpp::traits::input_parameter< Rcpp::List >::type polygons(polygonsSEXP);
-    rcpp_result_gen = Rcpp::wrap(C_reader(ifiles, ofile, select, filter, polygons));
+    rcpp_result_gen = Rcpp::wrap(C_reader_arrow(ifiles, select, filter, sort, polygons));
+    return rcpp_result_gen;
+END_RCPP
+}
+// C_reader_columnar
+void C_reader_columnar(CharacterVector ifiles, CharacterVector select, CharacterVector filter, CharacterVector sort, Rcpp::List polygons, CharacterVector ofile, CharacterVector key);
+RcppExport SEXP _rlas_C_reader_columnar(SEXP ifilesSEXP, SEXP selectSEXP, SEXP filterSEXP, SEXP sortSEXP, SEXP polygonsSEXP, SEXP ofileSEXP, SEXP keySEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< CharacterVector >::type ifiles(ifilesSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type select(selectSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type filter(filterSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type sort(sortSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type polygons(polygonsSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type ofile(ofileSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type key(keySEXP);
+    C_reader_columnar(ifiles, select, filter, sort, polygons, ofile, key);
+    return R_NilValue;
+END_RCPP
+}
+// C_reader_matrix
+List C_reader_matrix(CharacterVector ifiles, CharacterVector select, CharacterVector filter, CharacterVector sort, Rcpp::List polygons, bool quantized);
+RcppExport SEXP _rlas_C_reader_matrix(SEXP ifilesSEXP, SEXP selectSEXP, SEXP filterSEXP, SEXP sortSEXP, SEXP polygonsSEXP, SEXP quantizedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< CharacterVector >::type ifiles(ifilesSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type select(selectSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type filter(filterSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type sort(sortSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type polygons(polygonsSEXP);
+    Rcpp::traits::input_parameter< bool >::type quantized(quantizedSEXP);
+    rcpp_result_gen = Rcpp::wrap(C_reader_matrix(ifiles, select, filter, sort, polygons, quantized));
+    return rcpp_result_gen;
+END_RCPP
+}
+// C_memory_estimate
+List C_memory_estimate(CharacterVector ifiles, CharacterVector select, CharacterVector filter, CharacterVector sort, int sample);
+RcppExport SEXP _rlas_C_memory_estimate(SEXP ifilesSEXP, SEXP selectSEXP, SEXP filterSEXP, SEXP sortSEXP, SEXP sampleSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< CharacterVector >::type ifiles(ifilesSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type select(selectSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type filter(filterSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type sort(sortSEXP);
+    Rcpp::traits::input_parameter< int >::type sample(sampleSEXP);
+    rcpp_result_gen = Rcpp::wrap(C_memory_estimate(ifiles, select, filter, sort, sample));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -146,15 +303,114 @@ BEGIN_RCPP
     return R_NilValue;
 END_RCPP
 }
+// C_column_ranges
+List C_column_ranges(List x);
+RcppExport SEXP _rlas_C_column_ranges(SEXP xSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type x(xSEXP);
+    rcpp_result_gen = Rcpp::wrap(C_column_ranges(x));
+    return rcpp_result_gen;
+END_RCPP
+}
 // C_writer
-void C_writer(CharacterVector file, List LASheader, List data);
-RcppExport SEXP _rlas_C_writer(SEXP fileSEXP, SEXP LASheaderSEXP, SEXP dataSEXP) {
+void C_writer(CharacterVector file, List LASheader, List data, std::string sort, bool index);
+RcppExport SEXP _rlas_C_writer(SEXP fileSEXP, SEXP LASheaderSEXP, SEXP dataSEXP, SEXP sortSEXP, SEXP indexSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< CharacterVector >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< List >::type LASheader(LASheaderSEXP);
+    Rcpp::traits::input_parameter< List >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< std::string >::type sort(sortSEXP);
+    Rcpp::traits::input_parameter< bool >::type index(indexSEXP);
+    C_writer(file, LASheader, data, sort, index);
+    return R_NilValue;
+END_RCPP
+}
+// C_writer_raw
+RawVector C_writer_raw(List LASheader, List data, bool compress);
+RcppExport SEXP _rlas_C_writer_raw(SEXP LASheaderSEXP, SEXP dataSEXP, SEXP compressSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type LASheader(LASheaderSEXP);
+    Rcpp::traits::input_parameter< List >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< bool >::type compress(compressSEXP);
+    rcpp_result_gen = Rcpp::wrap(C_writer_raw(LASheader, data, compress));
+    return rcpp_result_gen;
+END_RCPP
+}
+// C_writer_arrow
+void C_writer_arrow(CharacterVector file, List LASheader, SEXP schema, SEXP array);
+RcppExport SEXP _rlas_C_writer_arrow(SEXP fileSEXP, SEXP LASheaderSEXP, SEXP schemaSEXP, SEXP arraySEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< CharacterVector >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< List >::type LASheader(LASheaderSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type schema(schemaSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type array(arraySEXP);
+    C_writer_arrow(file, LASheader, schema, array);
+    return R_NilValue;
+END_RCPP
+}
+// C_writer_copc
+void C_writer_copc(CharacterVector file, List LASheader, List data, double max_points_per_octant);
+RcppExport SEXP _rlas_C_writer_copc(SEXP fileSEXP, SEXP LASheaderSEXP, SEXP dataSEXP, SEXP max_points_per_octantSEXP) {
 BEGIN_RCPP
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< CharacterVector >::type file(fileSEXP);
     Rcpp::traits::input_parameter< List >::type LASheader(LASheaderSEXP);
     Rcpp::traits::input_parameter< List >::type data(dataSEXP);
-    C_writer(file, LASheader, data);
+    Rcpp::traits::input_parameter< double >::type max_points_per_octant(max_points_per_octantSEXP);
+    C_writer_copc(file, LASheader, data, max_points_per_octant);
+    return R_NilValue;
+END_RCPP
+}
+// C_writer_open
+SEXP C_writer_open(CharacterVector file, List LASheader, CharacterVector columns, bool index, bool append);
+RcppExport SEXP _rlas_C_writer_open(SEXP fileSEXP, SEXP LASheaderSEXP, SEXP columnsSEXP, SEXP indexSEXP, SEXP appendSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< CharacterVector >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< List >::type LASheader(LASheaderSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type columns(columnsSEXP);
+    Rcpp::traits::input_parameter< bool >::type index(indexSEXP);
+    Rcpp::traits::input_parameter< bool >::type append(appendSEXP);
+    rcpp_result_gen = Rcpp::wrap(C_writer_open(file, LASheader, columns, index, append));
+    return rcpp_result_gen;
+END_RCPP
+}
+// C_writer_write
+void C_writer_write(SEXP xwriter, List data);
+RcppExport SEXP _rlas_C_writer_write(SEXP xwriterSEXP, SEXP dataSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type xwriter(xwriterSEXP);
+    Rcpp::traits::input_parameter< List >::type data(dataSEXP);
+    C_writer_write(xwriter, data);
+    return R_NilValue;
+END_RCPP
+}
+// C_writer_close
+void C_writer_close(SEXP xwriter);
+RcppExport SEXP _rlas_C_writer_close(SEXP xwriterSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type xwriter(xwriterSEXP);
+    C_writer_close(xwriter);
+    return R_NilValue;
+END_RCPP
+}
+// C_writer_columns
+void C_writer_columns(CharacterVector file, List data);
+RcppExport SEXP _rlas_C_writer_columns(SEXP fileSEXP, SEXP dataSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< CharacterVector >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< List >::type data(dataSEXP);
+    C_writer_columns(file, data);
     return R_NilValue;
 END_RCPP
 }
@@ -169,28 +425,69 @@ BEGIN_RCPP
     return R_NilValue;
 END_RCPP
 }
+// lasheaderwriter
+void lasheaderwriter(CharacterVector file, List LASheader, CharacterVector columns);
+RcppExport SEXP _rlas_lasheaderwriter(SEXP fileSEXP, SEXP LASheaderSEXP, SEXP columnsSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< CharacterVector >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< List >::type LASheader(LASheaderSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type columns(columnsSEXP);
+    lasheaderwriter(file, LASheader, columns);
+    return R_NilValue;
+END_RCPP
+}
 
 static const R_CallMethodDef CallEntries[] = {
+    {"_rlas_R_block_compressed_size", (DL_FUNC) &_rlas_R_block_compressed_size, 1},
+    {"_rlas_R_block_compress", (DL_FUNC) &_rlas_R_block_compress, 3},
     {"_rlas_R_compact_rep", (DL_FUNC) &_rlas_R_compact_rep, 2},
     {"_rlas_R_is_altrep", (DL_FUNC) &_rlas_R_is_altrep, 1},
     {"_rlas_R_is_materialized", (DL_FUNC) &_rlas_R_is_materialized, 1},
     {"_rlas_R_altrep_full_class", (DL_FUNC) &_rlas_R_altrep_full_class, 1},
+    {"_rlas_C_columnar_attach", (DL_FUNC) &_rlas_C_columnar_attach, 1},
+    {"_rlas_C_columnar_key", (DL_FUNC) &_rlas_C_columnar_key, 1},
+    {"_rlas_R_narrow_size", (DL_FUNC) &_rlas_R_narrow_size, 1},
+    {"_rlas_R_narrow_integer", (DL_FUNC) &_rlas_R_narrow_integer, 2},
     {"_rlas_fast_countequal", (DL_FUNC) &_rlas_fast_countequal, 2},
     {"_rlas_fast_countbelow", (DL_FUNC) &_rlas_fast_countbelow, 2},
     {"_rlas_fast_countover", (DL_FUNC) &_rlas_fast_countover, 2},
     {"_rlas_fast_decimal_count", (DL_FUNC) &_rlas_fast_decimal_count, 1},
-    {"_rlas_C_reader", (DL_FUNC) &_rlas_C_reader, 5},
+    {"_rlas_fast_header_inventory", (DL_FUNC) &_rlas_fast_header_inventory, 4},
+    {"_rlas_fast_hash", (DL_FUNC) &_rlas_fast_hash, 1},
+    {"_rlas_C_reader", (DL_FUNC) &_rlas_C_reader, 6},
+    {"_rlas_C_reader_arrow", (DL_FUNC) &_rlas_C_reader_arrow, 5},
+    {"_rlas_C_reader_columnar", (DL_FUNC) &_rlas_C_reader_columnar, 7},
+    {"_rlas_C_reader_matrix", (DL_FUNC) &_rlas_C_reader_matrix, 6},
+    {"_rlas_C_memory_estimate", (DL_FUNC) &_rlas_C_memory_estimate, 5},
     {"_rlas_lasheaderreader", (DL_FUNC) &_rlas_lasheaderreader, 1},
     {"_rlas_lasfilterusage", (DL_FUNC) &_rlas_lasfilterusage, 0},
     {"_rlas_lastransformusage", (DL_FUNC) &_rlas_lastransformusage, 0},
-    {"_rlas_C_writer", (DL_FUNC) &_rlas_C_writer, 3},
+    {"_rlas_C_column_ranges", (DL_FUNC) &_rlas_C_column_ranges, 1},
+    {"_rlas_C_writer", (DL_FUNC) &_rlas_C_writer, 5},
+    {"_rlas_C_writer_raw", (DL_FUNC) &_rlas_C_writer_raw, 3},
+    {"_rlas_C_writer_arrow", (DL_FUNC) &_rlas_C_writer_arrow, 4},
+    {"_rlas_C_writer_copc", (DL_FUNC) &_rlas_C_writer_copc, 4},
+    {"_rlas_C_writer_open", (DL_FUNC) &_rlas_C_writer_open, 5},
+    {"_rlas_C_writer_write", (DL_FUNC) &_rlas_C_writer_write, 2},
+    {"_rlas_C_writer_close", (DL_FUNC) &_rlas_C_writer_close, 1},
+    {"_rlas_C_writer_columns", (DL_FUNC) &_rlas_C_writer_columns, 2},
     {"_rlas_laxwriter", (DL_FUNC) &_rlas_laxwriter, 2},
+    {"_rlas_lasheaderwriter", (DL_FUNC) &_rlas_lasheaderwriter, 3},
     {NULL, NULL, 0}
 };
 
+void init_altrep_block_compressed(DllInfo* dll);
 void init_alt_rep(DllInfo* dll);
+void init_altrep_mmap(DllInfo* dll);
+void init_altrep_narrow(DllInfo* dll);
+void init_altrep_vector(DllInfo* dll);
 RcppExport void R_init_rlas(DllInfo *dll) {
     R_registerRoutines(dll, NULL, CallEntries, NULL, NULL);
     R_useDynamicSymbols(dll, FALSE);
+    init_altrep_block_compressed(dll);
     init_alt_rep(dll);
+    init_altrep_mmap(dll);
+    init_altrep_narrow(dll);
+    init_altrep_vector(dll);
 }
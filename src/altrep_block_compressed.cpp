@@ -0,0 +1,696 @@
+#include "altrepisode.h"
+#include "altrep_block_compressed.h"
+#include "rlasthreads.h"
+
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// ALTREP numeric and integer vectors stored in independently compressed blocks of 65536 values.
+// Values are mapped to 64 bits integers (quantized coordinates, bit patterns of the doubles or
+// integers) and each block is encoded with the smallest of:
+// - frame of reference: value - min of the block, bit packed
+// - delta: zigzag encoded differences between consecutive values, bit packed
+// Coordinates of a block are spatially close and gpstime is almost sorted thus both compress to
+// a few bytes per value. Blocks are decoded independently in a small cache so Elt and Get_region
+// have random access and sequential scans decode each block once. If R needs a pointer to the
+// data the vector is decompressed into a regular vector stored in data2.
+
+#define BLOCK_SHIFT 16
+#define BLOCK_SIZE (1 << BLOCK_SHIFT)
+#define BLOCK_MASK (BLOCK_SIZE - 1)
+#define CACHE_SIZE 2
+
+enum BlockMode {BLOCK_FOR = 0, BLOCK_DELTA = 1};
+
+struct packed_block
+{
+  uint64_t n;
+  uint64_t mode;
+  uint64_t bits;
+  int64_t base;
+  int64_t min;
+  int64_t max;
+  std::vector<uint64_t> words;
+};
+
+// The compressed data. Immutable, thus shared between duplicated vectors.
+struct packed_vector
+{
+  bool real;
+  bool quantized;
+  bool has_na;
+  double scale;
+  double offset;
+  uint64_t n;
+  std::vector<packed_block> blocks;
+
+  uint64_t size() const
+  {
+    uint64_t s = sizeof(packed_vector);
+    for (const packed_block& b : blocks) s += sizeof(packed_block) + b.words.size()*8;
+    return s;
+  }
+};
+
+// ===============================
+// Codec
+// ===============================
+
+static inline uint64_t zigzag(int64_t x) { return ((uint64_t)x << 1) ^ (uint64_t)(x >> 63); }
+static inline int64_t unzigzag(uint64_t x) { return (int64_t)((x >> 1) ^ (~(x & 1) + 1)); }
+
+static int bitwidth(uint64_t x)
+{
+  int b = 0;
+  while (x) { b++; x >>= 1; }
+  return b;
+}
+
+// Single non inlined function so the quantization is tested and reversed with the same arithmetic
+static double dequantize(int64_t q, double scale, double offset)
+{
+  return scale * (double)q + offset;
+}
+
+static void pack(const uint64_t* v, uint64_t n, int bits, std::vector<uint64_t>& words)
+{
+  words.assign(bits == 0 ? 0 : (n*bits + 63)/64, 0);
+  if (bits == 0) return;
+
+  uint64_t pos = 0;
+  for (uint64_t i = 0 ; i < n ; i++, pos += bits)
+  {
+    uint64_t w = pos >> 6;
+    int s = pos & 63;
+    words[w] |= v[i] << s;
+    if (s + bits > 64) words[w+1] |= v[i] >> (64 - s);
+  }
+}
+
+static void unpack(const std::vector<uint64_t>& words, uint64_t n, int bits, uint64_t* v)
+{
+  if (bits == 0)
+  {
+    memset(v, 0, n*sizeof(uint64_t));
+    return;
+  }
+
+  uint64_t mask = (bits == 64) ? ~(uint64_t)0 : (((uint64_t)1 << bits) - 1);
+  uint64_t pos = 0;
+  for (uint64_t i = 0 ; i < n ; i++, pos += bits)
+  {
+    uint64_t w = pos >> 6;
+    int s = pos & 63;
+    uint64_t x = words[w] >> s;
+    if (s + bits > 64) x |= words[w+1] << (64 - s);
+    v[i] = x & mask;
+  }
+}
+
+static void encode(const int64_t* v, uint64_t n, packed_block& b)
+{
+  int64_t min = v[0];
+  int64_t max = v[0];
+  uint64_t deltas = 0;
+
+  for (uint64_t i = 1 ; i < n ; i++)
+  {
+    if (v[i] < min) min = v[i];
+    if (v[i] > max) max = v[i];
+    deltas |= zigzag((int64_t)((uint64_t)v[i] - (uint64_t)v[i-1]));
+  }
+
+  int bits_for = bitwidth((uint64_t)max - (uint64_t)min);
+  int bits_delta = bitwidth(deltas);
+
+  std::vector<uint64_t> tmp(n);
+
+  b.n = n;
+  b.min = min;
+  b.max = max;
+
+  if (bits_delta < bits_for)
+  {
+    b.mode = BLOCK_DELTA;
+    b.bits = bits_delta;
+    b.base = v[0];
+    tmp[0] = 0;
+    for (uint64_t i = 1 ; i < n ; i++) tmp[i] = zigzag((int64_t)((uint64_t)v[i] - (uint64_t)v[i-1]));
+  }
+  else
+  {
+    b.mode = BLOCK_FOR;
+    b.bits = bits_for;
+    b.base = min;
+    for (uint64_t i = 0 ; i < n ; i++) tmp[i] = (uint64_t)v[i] - (uint64_t)min;
+  }
+
+  pack(tmp.data(), n, b.bits, b.words);
+}
+
+static void decode(const packed_block& b, int64_t* v)
+{
+  uint64_t* u = (uint64_t*)v;
+  unpack(b.words, b.n, b.bits, u);
+
+  if (b.mode == BLOCK_FOR)
+  {
+    for (uint64_t i = 0 ; i < b.n ; i++) v[i] = (int64_t)((uint64_t)b.base + u[i]);
+  }
+  else
+  {
+    uint64_t acc = b.base;
+    for (uint64_t i = 0 ; i < b.n ; i++)
+    {
+      acc += (uint64_t)unzigzag(u[i]);
+      v[i] = (int64_t)acc;
+    }
+  }
+}
+
+// Converts the decoded 64 bits integers of a block into the R type
+static void convert(const packed_vector& p, const int64_t* v, uint64_t n, double* out)
+{
+  if (p.quantized)
+  {
+    for (uint64_t i = 0 ; i < n ; i++) out[i] = dequantize(v[i], p.scale, p.offset);
+  }
+  else
+  {
+    memcpy(out, v, n*sizeof(double));
+  }
+}
+
+static void convert(const packed_vector&, const int64_t* v, uint64_t n, int* out)
+{
+  for (uint64_t i = 0 ; i < n ; i++) out[i] = (int)v[i];
+}
+
+static inline int64_t to_int64(double x, const packed_vector& p)
+{
+  if (p.quantized) return llround((x - p.offset)/p.scale);
+  int64_t u;
+  memcpy(&u, &x, 8);
+  return u;
+}
+
+static inline int64_t to_int64(int x, const packed_vector&) { return x; }
+
+template<typename V> static void compress(const std::vector<V>& x, packed_vector& p)
+{
+  p.n = x.size();
+  uint64_t nblocks = (p.n + BLOCK_SIZE - 1) >> BLOCK_SHIFT;
+  p.blocks.resize(nblocks);
+
+  #pragma omp parallel for num_threads(rlas_threads()) schedule(dynamic)
+  for (int64_t k = 0 ; k < (int64_t)nblocks ; k++)
+  {
+    uint64_t start = (uint64_t)k << BLOCK_SHIFT;
+    uint64_t n = std::min((uint64_t)BLOCK_SIZE, p.n - start);
+    std::vector<int64_t> v(n);
+    for (uint64_t i = 0 ; i < n ; i++) v[i] = to_int64(x[start + i], p);
+    encode(v.data(), n, p.blocks[k]);
+  }
+}
+
+// The doubles can be quantized only if the quantization is exactly reversible for every value
+static bool is_quantizable(const std::vector<double>& x, double scale, double offset)
+{
+  if (scale == 0) return false;
+
+  bool ok = true;
+
+  #pragma omp parallel for num_threads(rlas_threads()) reduction(&&:ok)
+  for (int64_t i = 0 ; i < (int64_t)x.size() ; i++)
+  {
+    double q = (x[i] - offset)/scale;
+    if (!(fabs(q) < 4e18)) { ok = false; continue; }
+    double y = dequantize(llround(q), scale, offset);
+    ok = ok && memcmp(&y, &x[i], sizeof(double)) == 0;
+  }
+
+  return ok;
+}
+
+// ===============================
+// Serialization (little endian)
+// ===============================
+
+static void put(std::vector<uint8_t>& buf, uint64_t x)
+{
+  for (int j = 0 ; j < 8 ; j++) buf.push_back((x >> (8*j)) & 0xFF);
+}
+
+static void put(std::vector<uint8_t>& buf, double x)
+{
+  uint64_t u;
+  memcpy(&u, &x, 8);
+  put(buf, u);
+}
+
+struct reader
+{
+  const uint8_t* p;
+  const uint8_t* end;
+  bool ok;
+
+  uint64_t u64()
+  {
+    if (end - p < 8) { ok = false; return 0; }
+    uint64_t x = 0;
+    for (int j = 0 ; j < 8 ; j++) x |= (uint64_t)(*p++) << (8*j);
+    return x;
+  }
+
+  double f64()
+  {
+    uint64_t u = u64();
+    double x;
+    memcpy(&x, &u, 8);
+    return x;
+  }
+};
+
+static void serialize(const packed_vector& p, std::vector<uint8_t>& buf)
+{
+  put(buf, (uint64_t)p.real);
+  put(buf, (uint64_t)p.quantized);
+  put(buf, (uint64_t)p.has_na);
+  put(buf, p.scale);
+  put(buf, p.offset);
+  put(buf, p.n);
+  put(buf, (uint64_t)p.blocks.size());
+
+  for (const packed_block& b : p.blocks)
+  {
+    put(buf, b.n);
+    put(buf, b.mode);
+    put(buf, b.bits);
+    put(buf, (uint64_t)b.base);
+    put(buf, (uint64_t)b.min);
+    put(buf, (uint64_t)b.max);
+    put(buf, (uint64_t)b.words.size());
+    for (uint64_t w : b.words) put(buf, w);
+  }
+}
+
+static bool unserialize(const uint8_t* data, uint64_t size, packed_vector& p)
+{
+  reader r = {data, data + size, true};
+
+  p.real = r.u64();
+  p.quantized = r.u64();
+  p.has_na = r.u64();
+  p.scale = r.f64();
+  p.offset = r.f64();
+  p.n = r.u64();
+  uint64_t nblocks = r.u64();
+
+  if (!r.ok || nblocks != (p.n + BLOCK_SIZE - 1) >> BLOCK_SHIFT) return false;
+
+  p.blocks.resize(nblocks);
+  for (packed_block& b : p.blocks)
+  {
+    b.n = r.u64();
+    b.mode = r.u64();
+    b.bits = r.u64();
+    b.base = r.u64();
+    b.min = r.u64();
+    b.max = r.u64();
+    uint64_t nwords = r.u64();
+
+    if (!r.ok || b.n > BLOCK_SIZE || b.bits > 64 || nwords != (b.n*b.bits + 63)/64 || nwords > (uint64_t)(r.end - r.p)/8) return false;
+
+    b.words.resize(nwords);
+    for (uint64_t& w : b.words) w = r.u64();
+  }
+
+  return r.ok;
+}
+
+// ===============================
+// ALTREP class
+// ===============================
+
+static R_altrep_class_t block_compressed_real;
+static R_altrep_class_t block_compressed_integer;
+
+template<typename V>
+struct block_compressed
+{
+  // State of an R vector: the compressed data and the cache of decoded blocks
+  struct state
+  {
+    std::shared_ptr<const packed_vector> data;
+    int64_t cached[CACHE_SIZE];
+    std::vector<V> cache[CACHE_SIZE];
+    std::vector<int64_t> scratch;
+    int next;
+
+    state(std::shared_ptr<const packed_vector> p) : data(p), next(0)
+    {
+      for (int i = 0 ; i < CACHE_SIZE ; i++) cached[i] = -1;
+    }
+  };
+
+  static SEXP Make(std::shared_ptr<const packed_vector> p)
+  {
+    state* s = new state(p);
+
+    R_altrep_class_t class_t = std::is_same<V, double>::value ? block_compressed_real : block_compressed_integer;
+
+    SEXP xp = PROTECT(R_MakeExternalPtr(s, R_NilValue, R_NilValue));
+    R_RegisterCFinalizerEx(xp, block_compressed::Finalize, TRUE);
+    SEXP res = R_new_altrep(class_t, xp, R_NilValue);
+    UNPROTECT(1);
+    return res;
+  }
+
+  // finalizer for the external pointer
+  static void Finalize(SEXP xp)
+  {
+    delete static_cast<state*>(R_ExternalPtrAddr(xp));
+  }
+
+  static state& Get(SEXP vec)
+  {
+    return *static_cast<state*>(R_ExternalPtrAddr(R_altrep_data1(vec)));
+  }
+
+  static bool Materialized(SEXP vec)
+  {
+    return R_altrep_data2(vec) != R_NilValue;
+  }
+
+  // Values of a regular vector of the type of the class
+  static V* Values(SEXP x)
+  {
+    return (TYPEOF(x) == REALSXP) ? (V*)REAL(x) : (V*)INTEGER(x);
+  }
+
+  static V* Data(SEXP x)
+  {
+    return Values(R_altrep_data2(x));
+  }
+
+  // Decoded block k. Blocks are decoded in a round robin cache.
+  static const V* Block(state& s, uint64_t k)
+  {
+    for (int i = 0 ; i < CACHE_SIZE ; i++)
+    {
+      if (s.cached[i] == (int64_t)k) return s.cache[i].data();
+    }
+
+    const packed_block& b = s.data->blocks[k];
+    int i = s.next;
+    s.next = (s.next + 1) % CACHE_SIZE;
+    s.scratch.resize(b.n);
+    s.cache[i].resize(b.n);
+    decode(b, s.scratch.data());
+    convert(*s.data, s.scratch.data(), b.n, s.cache[i].data());
+    s.cached[i] = k;
+    return s.cache[i].data();
+  }
+
+  // ALTREP methods -------------------
+  static R_xlen_t Length(SEXP vec)
+  {
+    if (Materialized(vec)) return XLENGTH(R_altrep_data2(vec));
+    return Get(vec).data->n;
+  }
+
+  static Rboolean Inspect(SEXP x, int pre, int deep, int pvec, void (*inspect_subtree)(SEXP, int, int, int))
+  {
+    if (Materialized(x))
+    {
+      Rprintf("block compressed vector of length %lld (materialized)\n", (long long)Length(x));
+    }
+    else
+    {
+      const packed_vector& p = *Get(x).data;
+      Rprintf("block compressed vector of length %lld (%.2f bytes per value)\n", (long long)p.n, p.n ? (double)p.size()/p.n : 0.0);
+    }
+    return TRUE;
+  }
+
+  // The state is the compressed data: the vector is sent compressed to other processes
+  static SEXP Serialized_state(SEXP x)
+  {
+    if (Materialized(x)) return R_altrep_data2(x);
+
+    std::vector<uint8_t> buf;
+    serialize(*Get(x).data, buf);
+
+    SEXP state = Rf_allocVector(RAWSXP, buf.size());
+    memcpy(RAW(state), buf.data(), buf.size());
+    return state;
+  }
+
+  static SEXP Unserialize(SEXP /* class_ */, SEXP state)
+  {
+    if (TYPEOF(state) != RAWSXP) return state;
+
+    SEXP res = Attach(RAW(state), XLENGTH(state));
+    if (res == NULL) Rf_error("Cannot unserialize a block compressed vector: invalid state.");
+    return res;
+  }
+
+  // C++ objects must be destroyed before a long jump
+  static SEXP Attach(const uint8_t* data, uint64_t size)
+  {
+    std::shared_ptr<packed_vector> p = std::make_shared<packed_vector>();
+    if (!unserialize(data, size, *p)) return NULL;
+    return Make(p);
+  }
+
+  // Copies share the compressed data
+  static SEXP Duplicate(SEXP x, Rboolean deep)
+  {
+    if (Materialized(x)) return NULL;
+    return Make(Get(x).data);
+  }
+
+  // ALTVEC methods ------------------
+  static void* Dataptr(SEXP vec, Rboolean writeable)
+  {
+    if (Materialized(vec)) return Data(vec);
+
+    state& s = Get(vec);
+    const packed_vector& p = *s.data;
+
+    SEXP val = PROTECT(Rf_allocVector(std::is_same<V, double>::value ? REALSXP : INTSXP, p.n));
+    V* out = Values(val);
+
+    #pragma omp parallel for num_threads(rlas_threads()) schedule(dynamic)
+    for (int64_t k = 0 ; k < (int64_t)p.blocks.size() ; k++)
+    {
+      const packed_block& b = p.blocks[k];
+      std::vector<int64_t> v(b.n);
+      decode(b, v.data());
+      convert(p, v.data(), b.n, out + ((uint64_t)k << BLOCK_SHIFT));
+    }
+
+    R_set_altrep_data2(vec, val);
+    UNPROTECT(1);
+
+    // The regular vector is now the only storage. Duplicates keep the compressed data.
+    s.data.reset();
+    for (int i = 0 ; i < CACHE_SIZE ; i++)
+    {
+      s.cached[i] = -1;
+      std::vector<V>().swap(s.cache[i]);
+    }
+    std::vector<int64_t>().swap(s.scratch);
+
+    return out;
+  }
+
+  static const void* Dataptr_or_null(SEXP vec)
+  {
+    if (Materialized(vec)) return Data(vec);
+    return nullptr;
+  }
+
+  static V Elt(SEXP vec, R_xlen_t i)
+  {
+    if (Materialized(vec)) return Data(vec)[i];
+    return Block(Get(vec), i >> BLOCK_SHIFT)[i & BLOCK_MASK];
+  }
+
+  static R_xlen_t Get_region(SEXP vec, R_xlen_t start, R_xlen_t size, V* out)
+  {
+    R_xlen_t n = Length(vec);
+    R_xlen_t ncopy = (start + size > n) ? n - start : size;
+    if (ncopy <= 0) return 0;
+
+    if (Materialized(vec))
+    {
+      memcpy(out, Data(vec) + start, ncopy*sizeof(V));
+      return ncopy;
+    }
+
+    state& s = Get(vec);
+    R_xlen_t k = 0;
+    while (k < ncopy)
+    {
+      R_xlen_t i = start + k;
+      uint64_t b = i >> BLOCK_SHIFT;
+      R_xlen_t o = i & BLOCK_MASK;
+      R_xlen_t m = std::min((R_xlen_t)s.data->blocks[b].n - o, ncopy - k);
+      memcpy(out + k, Block(s, b) + o, m*sizeof(V));
+      k += m;
+    }
+
+    return ncopy;
+  }
+
+  // Quantized doubles and integers without NA: the values are ordered like the integers stored
+  static bool Ordered(SEXP vec)
+  {
+    if (Materialized(vec)) return false;
+    const packed_vector& p = *Get(vec).data;
+    if (p.n == 0) return false;
+    if (p.real) return p.quantized && p.scale > 0;
+    return !p.has_na;
+  }
+
+  static int No_NA(SEXP vec)
+  {
+    if (Materialized(vec)) return 0;
+    const packed_vector& p = *Get(vec).data;
+    return p.real ? p.quantized : !p.has_na;
+  }
+
+  // Min and max are read in the blocks without decoding. NULL delegates to R.
+  static SEXP Min(SEXP vec, Rboolean narm)
+  {
+    if (!Ordered(vec)) return NULL;
+    const packed_vector& p = *Get(vec).data;
+    int64_t m = p.blocks[0].min;
+    for (const packed_block& b : p.blocks) if (b.min < m) m = b.min;
+    return p.real ? Rf_ScalarReal(dequantize(m, p.scale, p.offset)) : Rf_ScalarInteger((int)m);
+  }
+
+  static SEXP Max(SEXP vec, Rboolean narm)
+  {
+    if (!Ordered(vec)) return NULL;
+    const packed_vector& p = *Get(vec).data;
+    int64_t m = p.blocks[0].max;
+    for (const packed_block& b : p.blocks) if (b.max > m) m = b.max;
+    return p.real ? Rf_ScalarReal(dequantize(m, p.scale, p.offset)) : Rf_ScalarInteger((int)m);
+  }
+
+  // -------- initialize the altrep class with the methods above
+  static void InitCommon(R_altrep_class_t class_t)
+  {
+    // altrep
+    R_set_altrep_Length_method(class_t, Length);
+    R_set_altrep_Inspect_method(class_t, Inspect);
+    R_set_altrep_Serialized_state_method(class_t, Serialized_state);
+    R_set_altrep_Unserialize_method(class_t, Unserialize);
+    R_set_altrep_Duplicate_method(class_t, Duplicate);
+
+    // altvec
+    R_set_altvec_Dataptr_method(class_t, Dataptr);
+    R_set_altvec_Dataptr_or_null_method(class_t, Dataptr_or_null);
+  }
+
+  static void InitReal(DllInfo* dll)
+  {
+    R_altrep_class_t class_t = R_make_altreal_class("block compressed (double)", "rlas", dll);
+    block_compressed_real = class_t;
+    InitCommon(class_t);
+    R_set_altreal_Elt_method(class_t, Elt);
+    R_set_altreal_Get_region_method(class_t, Get_region);
+    R_set_altreal_No_NA_method(class_t, No_NA);
+    R_set_altreal_Min_method(class_t, Min);
+    R_set_altreal_Max_method(class_t, Max);
+  }
+
+  static void InitInt(DllInfo* dll)
+  {
+    R_altrep_class_t class_t = R_make_altinteger_class("block compressed (int)", "rlas", dll);
+    block_compressed_integer = class_t;
+    InitCommon(class_t);
+    R_set_altinteger_Elt_method(class_t, Elt);
+    R_set_altinteger_Get_region_method(class_t, Get_region);
+    R_set_altinteger_No_NA_method(class_t, No_NA);
+    R_set_altinteger_Min_method(class_t, Min);
+    R_set_altinteger_Max_method(class_t, Max);
+  }
+};
+
+SEXP block_compressed_make(std::vector<double>& x, double scale, double offset)
+{
+  std::shared_ptr<packed_vector> p = std::make_shared<packed_vector>();
+  p->real = true;
+  p->quantized = is_quantizable(x, scale, offset);
+  p->has_na = false;
+  p->scale = p->quantized ? scale : 0;
+  p->offset = p->quantized ? offset : 0;
+  compress(x, *p);
+
+  std::vector<double>().swap(x);
+  return block_compressed<double>::Make(p);
+}
+
+SEXP block_compressed_make(std::vector<int>& x)
+{
+  std::shared_ptr<packed_vector> p = std::make_shared<packed_vector>();
+  p->real = false;
+  p->quantized = false;
+  p->has_na = std::find(x.begin(), x.end(), NA_INTEGER) != x.end();
+  p->scale = 0;
+  p->offset = 0;
+  compress(x, *p);
+
+  std::vector<int>().swap(x);
+  return block_compressed<int>::Make(p);
+}
+
+// [[Rcpp::init]]
+void init_altrep_block_compressed(DllInfo* dll)
+{
+  block_compressed<double>::InitReal(dll);
+  block_compressed<int>::InitInt(dll);
+}
+
+// Number of bytes of the compressed storage of a vector, 0 if x is not block compressed
+// [[Rcpp::export]]
+double R_block_compressed_size(SEXP x)
+{
+  if (!ALTREP(x)) return 0;
+
+  if (TYPEOF(x) == REALSXP && R_altrep_inherits(x, block_compressed_real) && !block_compressed<double>::Materialized(x))
+    return block_compressed<double>::Get(x).data->size();
+
+  if (TYPEOF(x) == INTSXP && R_altrep_inherits(x, block_compressed_integer) && !block_compressed<int>::Materialized(x))
+    return block_compressed<int>::Get(x).data->size();
+
+  return 0;
+}
+
+// Testing purpose: compresses an R vector
+// [[Rcpp::export]]
+SEXP R_block_compress(SEXP x, double scale, double offset)
+{
+  R_xlen_t n = XLENGTH(x);
+
+  if (TYPEOF(x) == REALSXP)
+  {
+    std::vector<double> v(REAL(x), REAL(x) + n);
+    return block_compressed_make(v, scale, offset);
+  }
+
+  std::vector<int> v(INTEGER(x), INTEGER(x) + n);
+  return block_compressed_make(v);
+}
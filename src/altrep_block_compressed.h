@@ -0,0 +1,15 @@
+#ifndef ALTREP_BLOCK_COMPRESSED_H
+#define ALTREP_BLOCK_COMPRESSED_H
+
+#include <Rinternals.h>
+#include <vector>
+
+// Numeric and integer vectors stored in independently compressed blocks. The vector is consumed:
+// its memory is released once compressed. See altrep_block_compressed.cpp
+//
+// If scale is not 0 the doubles are stored as the integers q such that x = q * scale + offset
+// (coordinates quantized in the las file). Otherwise the bit patterns of the doubles are stored.
+SEXP block_compressed_make(std::vector<double>& x, double scale = 0, double offset = 0);
+SEXP block_compressed_make(std::vector<int>& x);
+
+#endif //ALTREP_BLOCK_COMPRESSED_H
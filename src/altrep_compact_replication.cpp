@@ -1,11 +1,14 @@
 #include "altrepisode.h"
+#include "altrep_compact_replication.h"
+#include <limits.h>
+#include <string.h>
 #include <type_traits>
 
 template<typename T>
 struct repetition {
-  unsigned int size;
+  R_xlen_t size;
   T value;
-  repetition(int n, T v) : size(n), value(v) {}
+  repetition(R_xlen_t n, T v) : size(n), value(v) {}
 };
 
 static R_altrep_class_t compact_repetition_integer;
@@ -90,8 +93,7 @@ struct compact_repetition
     //Rprintf("Calling serialize_state on a compact_repetition at %p\n", R_ExternalPtrAddr(x));
 
     int val = Get(x).value;
-    int n = Get(x).size;
-    SEXP size = PROTECT(Rf_ScalarInteger(n));
+    SEXP size = PROTECT(Size(x));
     SEXP value = PROTECT(Rf_ScalarInteger(val));
     SEXP vec = PROTECT(Rf_allocVector(VECSXP, 2));
     SET_VECTOR_ELT(vec, 0, value);
@@ -105,8 +107,7 @@ struct compact_repetition
     //Rprintf("Calling serialize_state on a compact_repetition at %p\n", R_ExternalPtrAddr(x));
 
     double val = Get(x).value;
-    int n = Get(x).size;
-    SEXP size = PROTECT(Rf_ScalarInteger(n));
+    SEXP size = PROTECT(Size(x));
     SEXP value = PROTECT(Rf_ScalarReal(val));
     SEXP vec = PROTECT(Rf_allocVector(VECSXP, 2));
     SET_VECTOR_ELT(vec, 0, value);
@@ -120,8 +121,7 @@ struct compact_repetition
     //Rprintf("Calling serialize_state on a compact_repetition at %p\n", R_ExternalPtrAddr(x));
 
     double val = Get(x).value;
-    int n = Get(x).size;
-    SEXP size = PROTECT(Rf_ScalarInteger(n));
+    SEXP size = PROTECT(Size(x));
     SEXP value = PROTECT(Rf_ScalarLogical(val));
     SEXP vec = PROTECT(Rf_allocVector(VECSXP, 2));
     SET_VECTOR_ELT(vec, 0, value);
@@ -130,10 +130,17 @@ struct compact_repetition
     return vec;
   }
 
+  // The size is serialized as an integer or as a double for long vectors
+  static SEXP Size(SEXP x)
+  {
+    R_xlen_t n = Get(x).size;
+    return (n > INT_MAX) ? Rf_ScalarReal((double)n) : Rf_ScalarInteger((int)n);
+  }
+
   static SEXP Unserialize(SEXP /* class_ */, SEXP state)
   {
     //Rprintf("Calling unserialize on a compact_repetition\n");
-    int n = Rf_asInteger(VECTOR_ELT(state, 1));
+    R_xlen_t n = (R_xlen_t)Rf_asReal(VECTOR_ELT(state, 1));
     //Rprintf("n = %d\n", n);
 
     switch (TYPEOF(VECTOR_ELT(state, 0)))
@@ -190,11 +197,11 @@ struct compact_repetition
       return INTEGER(data2);
     }
 
-    int n = Length(vec);
+    R_xlen_t n = Length(vec);
     auto v = Get(vec).value;
     SEXP val = PROTECT(Rf_allocVector(INTSXP, n));
     int *p = INTEGER(val);
-    for (int i = 0; i < n; i++) p[i] = v;
+    for (R_xlen_t i = 0; i < n; i++) p[i] = v;
     R_set_altrep_data2(vec, val);
     UNPROTECT(1);
     return INTEGER(val);
@@ -207,11 +214,11 @@ struct compact_repetition
       return REAL(data2);
     }
 
-    int n = Length(vec);
+    R_xlen_t n = Length(vec);
     double v = Get(vec).value;
     SEXP val = PROTECT(Rf_allocVector(REALSXP, n));
     double *p = REAL(val);
-    for (int i = 0; i < n; i++) p[i] = v;
+    for (R_xlen_t i = 0; i < n; i++) p[i] = v;
     R_set_altrep_data2(vec, val);
     UNPROTECT(1);
     return REAL(val);
@@ -224,11 +231,11 @@ struct compact_repetition
       return LOGICAL(data2);
     }
 
-    int n = Length(vec);
+    R_xlen_t n = Length(vec);
     bool v = Get(vec).value;
     SEXP val = PROTECT(Rf_allocVector(LGLSXP, n));
     int *p = LOGICAL(val);
-    for (int i = 0; i < n; i++) p[i] = v ? TRUE : FALSE;
+    for (R_xlen_t i = 0; i < n; i++) p[i] = v ? TRUE : FALSE;
     R_set_altrep_data2(vec, val);
     UNPROTECT(1);
     return LOGICAL(val);
@@ -257,18 +264,54 @@ struct compact_repetition
     return Get(vec).value ? TRUE : FALSE;
   }
 
+  // The regions are filled with the value without expanding the vector
+  static R_xlen_t int_Get_region(SEXP vec, R_xlen_t start, R_xlen_t size, int* out)
+  {
+    R_xlen_t n = Length(vec);
+    R_xlen_t ncopy = (start + size > n) ? n - start : size;
+    if (ncopy <= 0) return 0;
+    SEXP data2 = R_altrep_data2(vec);
+    if (data2 != R_NilValue)
+    {
+      memcpy(out, INTEGER(data2) + start, ncopy * sizeof(int));
+      return ncopy;
+    }
+    int v = (std::is_same<T, bool>::value) ? (Get(vec).value ? TRUE : FALSE) : (int)Get(vec).value;
+    for (R_xlen_t i = 0; i < ncopy; i++) out[i] = v;
+    return ncopy;
+  }
+
+  static R_xlen_t real_Get_region(SEXP vec, R_xlen_t start, R_xlen_t size, double* out)
+  {
+    R_xlen_t n = Length(vec);
+    R_xlen_t ncopy = (start + size > n) ? n - start : size;
+    if (ncopy <= 0) return 0;
+    SEXP data2 = R_altrep_data2(vec);
+    if (data2 != R_NilValue)
+    {
+      memcpy(out, REAL(data2) + start, ncopy * sizeof(double));
+      return ncopy;
+    }
+    double v = Get(vec).value;
+    for (R_xlen_t i = 0; i < ncopy; i++) out[i] = v;
+    return ncopy;
+  }
+
   static SEXP extract_subset_int(SEXP x, SEXP indx, SEXP call)
   {
     //Rprintf("Extracting subset\n");
     if (x == R_NilValue) return x;
 
+    // Indices of long vectors are doubles: let R extract the subset
+    if (TYPEOF(indx) != INTSXP) return NULL;
+
     int *p = INTEGER(indx);
     R_xlen_t n = XLENGTH(indx);
     R_xlen_t s = Length(x);
     int v = Get(x).value;
 
     bool indx_out_of_bound = false;
-    for (int i = 0; i < n; i++)
+    for (R_xlen_t i = 0; i < n; i++)
     {
       if (p[i] > s || p[i] < 1)
       {
@@ -282,7 +325,7 @@ struct compact_repetition
       SEXP out = PROTECT(Rf_allocVector(INTSXP, n));
       int *pout = INTEGER(out);
       p = INTEGER(indx);
-      for (int i = 0; i < n; i++)
+      for (R_xlen_t i = 0; i < n; i++)
       {
         if (p[i] <= s && p[i] > 0)
           pout[i] = v;
@@ -304,13 +347,16 @@ struct compact_repetition
     //Rprintf("Extracting subset\n");
     if (x == R_NilValue) return x;
 
+    // Indices of long vectors are doubles: let R extract the subset
+    if (TYPEOF(indx) != INTSXP) return NULL;
+
     int *p = INTEGER(indx);
     R_xlen_t n = XLENGTH(indx);
     R_xlen_t s = Length(x);
     double v = Get(x).value;
 
     bool indx_out_of_bound = false;
-    for (int i = 0; i < n; i++)
+    for (R_xlen_t i = 0; i < n; i++)
     {
       if (p[i] > s || p[i] < 1)
       {
@@ -324,7 +370,7 @@ struct compact_repetition
       SEXP out = PROTECT(Rf_allocVector(REALSXP, n));
       double *pout = REAL(out);
       p = INTEGER(indx);
-      for (int i = 0; i < n; i++)
+      for (R_xlen_t i = 0; i < n; i++)
       {
         if (p[i] <= s && p[i] > 0)
           pout[i] = v;
@@ -346,13 +392,16 @@ struct compact_repetition
     //Rprintf("Extracting subset\n");
     if (x == R_NilValue) return x;
 
+    // Indices of long vectors are doubles: let R extract the subset
+    if (TYPEOF(indx) != INTSXP) return NULL;
+
     int *p = INTEGER(indx);
     R_xlen_t n = XLENGTH(indx);
     R_xlen_t s = Length(x);
     bool v = Get(x).value;
 
     bool indx_out_of_bound = false;
-    for (int i = 0; i < n; i++)
+    for (R_xlen_t i = 0; i < n; i++)
     {
       if (p[i] > s || p[i] < 1)
       {
@@ -366,7 +415,7 @@ struct compact_repetition
       SEXP out = PROTECT(Rf_allocVector(LGLSXP, n));
       int *pout = LOGICAL(out);
       p = INTEGER(indx);
-      for (int i = 0; i < n; i++)
+      for (R_xlen_t i = 0; i < n; i++)
       {
         if (p[i] <= s && p[i] > 0)
           pout[i] = v ? TRUE: FALSE;
@@ -402,6 +451,7 @@ struct compact_repetition
 
     // altint
     R_set_altinteger_Elt_method(class_t, int_Elt);
+    R_set_altinteger_Get_region_method(class_t, int_Get_region);
     R_set_altinteger_Min_method(class_t, int_Max);
     R_set_altinteger_Max_method(class_t, int_Min);
   }
@@ -424,6 +474,7 @@ struct compact_repetition
 
     // altint
     R_set_altreal_Elt_method(class_t, real_Elt);
+    R_set_altreal_Get_region_method(class_t, real_Get_region);
     R_set_altreal_Min_method(class_t, real_Max);
     R_set_altreal_Max_method(class_t, real_Min);
   }
@@ -446,6 +497,7 @@ struct compact_repetition
 
     // altlgl
     R_set_altlogical_Elt_method(class_t, logical_Elt);
+    R_set_altlogical_Get_region_method(class_t, int_Get_region);
   }
 };
 
@@ -457,8 +509,25 @@ void init_alt_rep(DllInfo* dll){
   compact_repetition<bool>::InitLogical(dll);
 }
 
+bool compact_repetition_value(SEXP x, double& value)
+{
+  // Once expanded the memory of the vector may have been modified by reference
+  if (!ALTREP(x) || R_altrep_data2(x) != R_NilValue) return false;
+
+  if (R_altrep_inherits(x, compact_repetition_integer))
+    value = compact_repetition<int>::Get(x).value;
+  else if (R_altrep_inherits(x, compact_repetition_real))
+    value = compact_repetition<double>::Get(x).value;
+  else if (R_altrep_inherits(x, compact_repetition_logical))
+    value = compact_repetition<bool>::Get(x).value;
+  else
+    return false;
+
+  return true;
+}
+
 // [[Rcpp::export]]
-SEXP R_compact_rep(int n, SEXP v)
+SEXP R_compact_rep(R_xlen_t n, SEXP v)
 {
   switch (TYPEOF(v))
   {
@@ -0,0 +1,10 @@
+#ifndef ALTREP_COMPACT_REPLICATION_H
+#define ALTREP_COMPACT_REPLICATION_H
+
+#include <Rinternals.h>
+
+// Whether x is a compact repetition that was not expanded. If so value is the repeated value (a
+// logical is 0 or 1) and x can be read without being expanded. See altrep_compact_replication.cpp
+bool compact_repetition_value(SEXP x, double& value);
+
+#endif //ALTREP_COMPACT_REPLICATION_H
@@ -0,0 +1,249 @@
+#include "altrepisode.h"
+#include "rlascolumnar.h"
+
+#include <memory>
+#include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+
+// ALTREP vectors that view a column of a memory mapped columnar file (see rlascolumnar.h).
+// The vectors do not own any memory: elements are read from the mapping that is shared between
+// all the R processes that attached the same file. The mapping is copy-on-write, thus R can
+// modify a vector: only the modified pages are copied and the file is never modified. A vector
+// that may have been modified is serialized with its values instead of the file it views.
+
+static R_altrep_class_t mmap_column_integer;
+static R_altrep_class_t mmap_column_real;
+static R_altrep_class_t mmap_column_logical;
+
+struct mmap_column
+{
+  std::shared_ptr<RLASColumnarFile> file;
+  int index;
+  bool modified;
+
+  static SEXP Make(const std::shared_ptr<RLASColumnarFile>& file, int index)
+  {
+    mmap_column* data = new mmap_column;
+    data->file = file;
+    data->index = index;
+    data->modified = false;
+
+    R_altrep_class_t class_t;
+
+    switch (file->get_type(index))
+    {
+      case RLAS_COLUMN_INT: class_t = mmap_column_integer; break;
+      case RLAS_COLUMN_DOUBLE: class_t = mmap_column_real; break;
+      case RLAS_COLUMN_LOGICAL: class_t = mmap_column_logical; break;
+      default: delete data; Rf_error("Unknown column type in file %s", file->get_path().c_str());
+    }
+
+    SEXP xp = PROTECT(R_MakeExternalPtr(data, R_NilValue, R_NilValue));
+    R_RegisterCFinalizerEx(xp, mmap_column::Finalize, TRUE);
+    SEXP res = R_new_altrep(class_t, xp, R_NilValue);
+    UNPROTECT(1);
+    return res;
+  }
+
+  // finalizer for the external pointer. The mapping is released with the last column.
+  static void Finalize(SEXP xp)
+  {
+    delete static_cast<mmap_column*>(R_ExternalPtrAddr(xp));
+  }
+
+  static mmap_column& Get(SEXP vec)
+  {
+    return *static_cast<mmap_column*>(R_ExternalPtrAddr(R_altrep_data1(vec)));
+  }
+
+  // ALTREP methods -------------------
+  static R_xlen_t Length(SEXP vec)
+  {
+    mmap_column& col = Get(vec);
+    return col.file->get_length(col.index);
+  }
+
+  static Rboolean Inspect(SEXP x, int pre, int deep, int pvec, void (*inspect_subtree)(SEXP, int, int, int))
+  {
+    mmap_column& col = Get(x);
+    Rprintf("mmap column '%s' of %s\n", col.file->get_name(col.index).c_str(), col.file->get_path().c_str());
+    return TRUE;
+  }
+
+  // The state is the file and the name of the column. Sending a point cloud to a process on the
+  // same host thus sends only a few bytes and the process attaches the same file. The pages of a
+  // vector modified in place are private to this process: no state makes R serialize the values.
+  static SEXP Serialized_state(SEXP x)
+  {
+    mmap_column& col = Get(x);
+    if (col.modified) return NULL;
+
+    SEXP vec = PROTECT(Rf_allocVector(STRSXP, 2));
+    SET_STRING_ELT(vec, 0, Rf_mkChar(col.file->get_path().c_str()));
+    SET_STRING_ELT(vec, 1, Rf_mkChar(col.file->get_name(col.index).c_str()));
+    UNPROTECT(1);
+    return vec;
+  }
+
+  static SEXP Unserialize(SEXP /* class_ */, SEXP state)
+  {
+    // C++ objects must be destroyed before a long jump
+    char msg[1024];
+    SEXP res = Attach(CHAR(STRING_ELT(state, 0)), CHAR(STRING_ELT(state, 1)), msg, sizeof(msg));
+    if (res == NULL) Rf_error("Cannot unserialize a memory mapped column. %s", msg);
+    return res;
+  }
+
+  static SEXP Attach(const char* path, const char* name, char* msg, size_t size)
+  {
+    try
+    {
+      std::shared_ptr<RLASColumnarFile> file = std::make_shared<RLASColumnarFile>(path);
+
+      int index = file->find(name);
+      if (index < 0) throw std::runtime_error(std::string("Column ") + name + " not found in " + path);
+
+      return Make(file, index);
+    }
+    catch (std::exception& e)
+    {
+      snprintf(msg, size, "%s", e.what());
+      return NULL;
+    }
+  }
+
+  // ALTVEC methods ------------------
+  // A writeable pointer (e.g. INTEGER() or REAL()) may be used to modify the vector in place
+  static void* Dataptr(SEXP vec, Rboolean writeable)
+  {
+    mmap_column& col = Get(vec);
+    if (writeable) col.modified = true;
+    return col.file->get_data(col.index);
+  }
+
+  static const void* Dataptr_or_null(SEXP vec)
+  {
+    mmap_column& col = Get(vec);
+    return col.file->get_data(col.index);
+  }
+
+  // ALTINT, ALTREAL, ALTLOGICAL methods -----------------
+  static int int_Elt(SEXP vec, R_xlen_t i)
+  {
+    return ((int*)Dataptr_or_null(vec))[i];
+  }
+
+  static double real_Elt(SEXP vec, R_xlen_t i)
+  {
+    return ((double*)Dataptr_or_null(vec))[i];
+  }
+
+  template<typename T> static R_xlen_t Get_region(SEXP vec, R_xlen_t start, R_xlen_t size, T* out)
+  {
+    R_xlen_t n = Length(vec);
+    R_xlen_t ncopy = (start + size > n) ? n - start : size;
+    if (ncopy <= 0) return 0;
+    memcpy(out, (const T*)Dataptr_or_null(vec) + start, ncopy * sizeof(T));
+    return ncopy;
+  }
+
+  static R_xlen_t int_Get_region(SEXP vec, R_xlen_t start, R_xlen_t size, int* out) { return Get_region<int>(vec, start, size, out); }
+  static R_xlen_t real_Get_region(SEXP vec, R_xlen_t start, R_xlen_t size, double* out) { return Get_region<double>(vec, start, size, out); }
+
+  // -------- initialize the altrep class with the methods above
+  static void InitCommon(R_altrep_class_t class_t)
+  {
+    // altrep
+    R_set_altrep_Length_method(class_t, Length);
+    R_set_altrep_Inspect_method(class_t, Inspect);
+    R_set_altrep_Serialized_state_method(class_t, Serialized_state);
+    R_set_altrep_Unserialize_method(class_t, Unserialize);
+
+    // altvec
+    R_set_altvec_Dataptr_method(class_t, Dataptr);
+    R_set_altvec_Dataptr_or_null_method(class_t, Dataptr_or_null);
+  }
+
+  static void InitInt(DllInfo* dll)
+  {
+    R_altrep_class_t class_t = R_make_altinteger_class("mmap column (int)", "rlas", dll);
+    mmap_column_integer = class_t;
+    InitCommon(class_t);
+    R_set_altinteger_Elt_method(class_t, int_Elt);
+    R_set_altinteger_Get_region_method(class_t, int_Get_region);
+  }
+
+  static void InitReal(DllInfo* dll)
+  {
+    R_altrep_class_t class_t = R_make_altreal_class("mmap column (double)", "rlas", dll);
+    mmap_column_real = class_t;
+    InitCommon(class_t);
+    R_set_altreal_Elt_method(class_t, real_Elt);
+    R_set_altreal_Get_region_method(class_t, real_Get_region);
+  }
+
+  static void InitLogical(DllInfo* dll)
+  {
+    R_altrep_class_t class_t = R_make_altlogical_class("mmap column (bool)", "rlas", dll);
+    mmap_column_logical = class_t;
+    InitCommon(class_t);
+    R_set_altlogical_Elt_method(class_t, int_Elt);
+    R_set_altlogical_Get_region_method(class_t, int_Get_region);
+  }
+};
+
+// [[Rcpp::init]]
+void init_altrep_mmap(DllInfo* dll)
+{
+  mmap_column::InitInt(dll);
+  mmap_column::InitReal(dll);
+  mmap_column::InitLogical(dll);
+}
+
+// Attach a columnar file: the columns are ALTREP views on the mapping. Constant columns are returned
+// as length 1 vectors like C_reader does.
+// [[Rcpp::export]]
+SEXP C_columnar_attach(SEXP file)
+{
+  // Errors are thrown as C++ exceptions and converted into R errors by Rcpp
+  std::shared_ptr<RLASColumnarFile> columnar = std::make_shared<RLASColumnarFile>(CHAR(STRING_ELT(file, 0)));
+
+  int ncol = columnar->get_ncolumns();
+  SEXP out = PROTECT(Rf_allocVector(VECSXP, ncol));
+  SEXP names = PROTECT(Rf_allocVector(STRSXP, ncol));
+
+  for (int i = 0 ; i < ncol ; i++)
+  {
+    SET_STRING_ELT(names, i, Rf_mkChar(columnar->get_name(i).c_str()));
+
+    if (columnar->get_length(i) == 1 && columnar->get_npoints() != 1)
+    {
+      switch (columnar->get_type(i))
+      {
+        case RLAS_COLUMN_INT: SET_VECTOR_ELT(out, i, Rf_ScalarInteger(*(int*)columnar->get_data(i))); break;
+        case RLAS_COLUMN_DOUBLE: SET_VECTOR_ELT(out, i, Rf_ScalarReal(*(double*)columnar->get_data(i))); break;
+        case RLAS_COLUMN_LOGICAL: SET_VECTOR_ELT(out, i, Rf_ScalarLogical(*(int*)columnar->get_data(i))); break;
+      }
+    }
+    else
+    {
+      SET_VECTOR_ELT(out, i, mmap_column::Make(columnar, i));
+    }
+  }
+
+  Rf_setAttrib(out, R_NamesSymbol, names);
+  UNPROTECT(2);
+  return out;
+}
+
+// Key of a columnar file or NA if the file is not a valid columnar file
+// [[Rcpp::export]]
+SEXP C_columnar_key(SEXP file)
+{
+  std::string key;
+  if (!RLASColumnarFile::read_key(CHAR(STRING_ELT(file, 0)), key))
+    return Rf_ScalarString(NA_STRING);
+
+  return Rf_mkString(key.c_str());
+}
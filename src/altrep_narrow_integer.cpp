@@ -0,0 +1,275 @@
+#include "altrepisode.h"
+#include "altrep_narrow_integer.h"
+
+#include <limits.h>
+#include <type_traits>
+
+// ALTREP integer vectors backed by 8 or 16 bits unsigned storage. Most LAS attributes are stored
+// on 8 bits (ReturnNumber, Classification, UserData...) or 16 bits (Intensity, RGB, PointSourceID...)
+// in the files but R only has 32 bits integers. The streamer fills std::vectors of the file type
+// that are moved into these objects. R reads them with Elt and Get_region. If R needs a pointer
+// to the data, the vector is expanded into a regular INTSXP stored in data2 and the narrow
+// storage is released. Narrow vectors never contain NA.
+
+static R_altrep_class_t narrow_integer_uint8;
+static R_altrep_class_t narrow_integer_uint16;
+
+template<typename T>
+struct narrow_integer
+{
+  // constructor function. x is moved into the object.
+  static SEXP Make(std::vector<T>& x)
+  {
+    std::vector<T>* data = new std::vector<T>();
+    data->swap(x);
+
+    R_altrep_class_t class_t = std::is_same<T, uint8_t>::value ? narrow_integer_uint8 : narrow_integer_uint16;
+
+    SEXP xp = PROTECT(R_MakeExternalPtr(data, R_NilValue, R_NilValue));
+    R_RegisterCFinalizerEx(xp, narrow_integer::Finalize, TRUE);
+    SEXP res = R_new_altrep(class_t, xp, R_NilValue);
+    UNPROTECT(1);
+    return res;
+  }
+
+  // finalizer for the external pointer
+  static void Finalize(SEXP xp)
+  {
+    delete static_cast<std::vector<T>*>(R_ExternalPtrAddr(xp));
+  }
+
+  static std::vector<T>& Get(SEXP vec)
+  {
+    return *static_cast<std::vector<T>*>(R_ExternalPtrAddr(R_altrep_data1(vec)));
+  }
+
+  static bool Materialized(SEXP vec)
+  {
+    return R_altrep_data2(vec) != R_NilValue;
+  }
+
+  // ALTREP methods -------------------
+  static R_xlen_t Length(SEXP vec)
+  {
+    if (Materialized(vec)) return XLENGTH(R_altrep_data2(vec));
+    return Get(vec).size();
+  }
+
+  static Rboolean Inspect(SEXP x, int pre, int deep, int pvec, void (*inspect_subtree)(SEXP, int, int, int))
+  {
+    Rprintf("narrow integer (uint%d) of length %lld%s\n", (int)(8*sizeof(T)), (long long)Length(x), Materialized(x) ? " (materialized)" : "");
+    return TRUE;
+  }
+
+  // The state is the narrow storage in little endian in a raw vector, or the INTSXP if the vector
+  // has been materialized (it may have been modified).
+  static SEXP Serialized_state(SEXP x)
+  {
+    if (Materialized(x)) return R_altrep_data2(x);
+
+    std::vector<T>& data = Get(x);
+    SEXP state = PROTECT(Rf_allocVector(RAWSXP, data.size() * sizeof(T)));
+    Rbyte* p = RAW(state);
+
+    for (size_t i = 0 ; i < data.size() ; i++)
+    {
+      for (size_t j = 0 ; j < sizeof(T) ; j++)
+        *p++ = (data[i] >> (8*j)) & 0xFF;
+    }
+
+    UNPROTECT(1);
+    return state;
+  }
+
+  static SEXP Unserialize(SEXP /* class_ */, SEXP state)
+  {
+    if (TYPEOF(state) == INTSXP) return state;
+
+    R_xlen_t n = XLENGTH(state) / sizeof(T);
+    const Rbyte* p = RAW(state);
+
+    std::vector<T> data(n);
+    for (R_xlen_t i = 0 ; i < n ; i++)
+    {
+      T value = 0;
+      for (size_t j = 0 ; j < sizeof(T) ; j++)
+        value |= (T)(*p++) << (8*j);
+      data[i] = value;
+    }
+
+    return Make(data);
+  }
+
+  // Copying a narrow vector does not expand it
+  static SEXP Duplicate(SEXP x, Rboolean deep)
+  {
+    if (Materialized(x)) return NULL;
+
+    std::vector<T> copy(Get(x));
+    return Make(copy);
+  }
+
+  // ALTVEC methods ------------------
+  static void* Dataptr(SEXP vec, Rboolean writeable)
+  {
+    if (Materialized(vec)) return INTEGER(R_altrep_data2(vec));
+
+    std::vector<T>& data = Get(vec);
+    R_xlen_t n = data.size();
+    SEXP val = PROTECT(Rf_allocVector(INTSXP, n));
+    int* p = INTEGER(val);
+    for (R_xlen_t i = 0 ; i < n ; i++) p[i] = data[i];
+    R_set_altrep_data2(vec, val);
+    UNPROTECT(1);
+
+    // The INTSXP is now the only storage
+    data.clear();
+    data.shrink_to_fit();
+
+    return INTEGER(val);
+  }
+
+  static const void* Dataptr_or_null(SEXP vec)
+  {
+    if (Materialized(vec)) return INTEGER(R_altrep_data2(vec));
+    return nullptr;
+  }
+
+  // ALTINT methods -----------------
+  static int Elt(SEXP vec, R_xlen_t i)
+  {
+    if (Materialized(vec)) return INTEGER(R_altrep_data2(vec))[i];
+    return Get(vec)[i];
+  }
+
+  static R_xlen_t Get_region(SEXP vec, R_xlen_t start, R_xlen_t size, int* out)
+  {
+    R_xlen_t n = Length(vec);
+    R_xlen_t ncopy = (start + size > n) ? n - start : size;
+    if (ncopy <= 0) return 0;
+
+    if (Materialized(vec))
+    {
+      const int* p = INTEGER(R_altrep_data2(vec)) + start;
+      for (R_xlen_t i = 0 ; i < ncopy ; i++) out[i] = p[i];
+    }
+    else
+    {
+      const T* p = Get(vec).data() + start;
+      for (R_xlen_t i = 0 ; i < ncopy ; i++) out[i] = p[i];
+    }
+
+    return ncopy;
+  }
+
+  static int No_NA(SEXP vec)
+  {
+    return !Materialized(vec);
+  }
+
+  // Min, max and sum are computed on the narrow storage. NULL delegates to R that handles empty
+  // vectors, NAs and overflows.
+  static SEXP Min(SEXP vec, Rboolean narm)
+  {
+    if (Materialized(vec) || Get(vec).empty()) return NULL;
+
+    std::vector<T>& data = Get(vec);
+    T m = data[0];
+    for (T v : data) if (v < m) m = v;
+    return Rf_ScalarInteger(m);
+  }
+
+  static SEXP Max(SEXP vec, Rboolean narm)
+  {
+    if (Materialized(vec) || Get(vec).empty()) return NULL;
+
+    std::vector<T>& data = Get(vec);
+    T m = data[0];
+    for (T v : data) if (v > m) m = v;
+    return Rf_ScalarInteger(m);
+  }
+
+  static SEXP Sum(SEXP vec, Rboolean narm)
+  {
+    if (Materialized(vec)) return NULL;
+
+    uint64_t s = 0;
+    for (T v : Get(vec)) s += v;
+
+    if (s > (uint64_t)INT_MAX) return NULL;
+    return Rf_ScalarInteger((int)s);
+  }
+
+  // -------- initialize the altrep class with the methods above
+  static void Init(DllInfo* dll)
+  {
+    const char* name = std::is_same<T, uint8_t>::value ? "narrow integer (uint8)" : "narrow integer (uint16)";
+    R_altrep_class_t class_t = R_make_altinteger_class(name, "rlas", dll);
+
+    if (std::is_same<T, uint8_t>::value)
+      narrow_integer_uint8 = class_t;
+    else
+      narrow_integer_uint16 = class_t;
+
+    // altrep
+    R_set_altrep_Length_method(class_t, Length);
+    R_set_altrep_Inspect_method(class_t, Inspect);
+    R_set_altrep_Serialized_state_method(class_t, Serialized_state);
+    R_set_altrep_Unserialize_method(class_t, Unserialize);
+    R_set_altrep_Duplicate_method(class_t, Duplicate);
+
+    // altvec
+    R_set_altvec_Dataptr_method(class_t, Dataptr);
+    R_set_altvec_Dataptr_or_null_method(class_t, Dataptr_or_null);
+
+    // altint
+    R_set_altinteger_Elt_method(class_t, Elt);
+    R_set_altinteger_Get_region_method(class_t, Get_region);
+    R_set_altinteger_No_NA_method(class_t, No_NA);
+    R_set_altinteger_Min_method(class_t, Min);
+    R_set_altinteger_Max_method(class_t, Max);
+    R_set_altinteger_Sum_method(class_t, Sum);
+  }
+};
+
+SEXP narrow_integer_make(std::vector<uint8_t>& x) { return narrow_integer<uint8_t>::Make(x); }
+SEXP narrow_integer_make(std::vector<uint16_t>& x) { return narrow_integer<uint16_t>::Make(x); }
+
+// [[Rcpp::init]]
+void init_altrep_narrow(DllInfo* dll)
+{
+  narrow_integer<uint8_t>::Init(dll);
+  narrow_integer<uint16_t>::Init(dll);
+}
+
+// Number of bytes of the narrow storage of a vector, 0 if x is not a narrow integer
+// [[Rcpp::export]]
+double R_narrow_size(SEXP x)
+{
+  if (!ALTREP(x) || TYPEOF(x) != INTSXP) return 0;
+
+  if (R_altrep_inherits(x, narrow_integer_uint8) && !narrow_integer<uint8_t>::Materialized(x))
+    return narrow_integer<uint8_t>::Get(x).size();
+
+  if (R_altrep_inherits(x, narrow_integer_uint16) && !narrow_integer<uint16_t>::Materialized(x))
+    return narrow_integer<uint16_t>::Get(x).size() * 2;
+
+  return 0;
+}
+
+// Testing purpose: builds a narrow vector from an R integer vector
+// [[Rcpp::export]]
+SEXP R_narrow_integer(SEXP x, int bits)
+{
+  const int* p = INTEGER(x);
+  R_xlen_t n = XLENGTH(x);
+
+  if (bits == 8)
+  {
+    std::vector<uint8_t> v(p, p + n);
+    return narrow_integer_make(v);
+  }
+
+  std::vector<uint16_t> v(p, p + n);
+  return narrow_integer_make(v);
+}
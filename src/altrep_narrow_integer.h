@@ -0,0 +1,13 @@
+#ifndef ALTREP_NARROW_INTEGER_H
+#define ALTREP_NARROW_INTEGER_H
+
+#include <Rinternals.h>
+#include <stdint.h>
+#include <vector>
+
+// Integer vectors stored with 1 or 2 bytes per element. The memory of the vector is moved into
+// the ALTREP object. See altrep_narrow_integer.cpp
+SEXP narrow_integer_make(std::vector<uint8_t>& x);
+SEXP narrow_integer_make(std::vector<uint16_t>& x);
+
+#endif //ALTREP_NARROW_INTEGER_H
@@ -0,0 +1,124 @@
+#include "altrepisode.h"
+#include "altrep_vector.h"
+
+#include <string.h>
+#include <type_traits>
+
+// ALTREP vectors whose memory is a std::vector filled by the streamer. The vector is moved into the
+// object so a column read by LASlib is given to R without being copied. Unlike narrow integers the
+// elements have the R type thus R can read and write the memory directly. The vectors are
+// serialized and duplicated as regular vectors.
+
+static R_altrep_class_t std_vector_real;
+static R_altrep_class_t std_vector_integer;
+
+template<typename T>
+struct std_vector
+{
+  // constructor function. x is moved into the object.
+  static SEXP Make(std::vector<T>& x)
+  {
+    // The data pointer of an empty std::vector may be null
+    if (x.empty()) return Rf_allocVector(std::is_same<T, double>::value ? REALSXP : INTSXP, 0);
+
+    std::vector<T>* data = new std::vector<T>();
+    data->swap(x);
+
+    R_altrep_class_t class_t = std::is_same<T, double>::value ? std_vector_real : std_vector_integer;
+
+    SEXP xp = PROTECT(R_MakeExternalPtr(data, R_NilValue, R_NilValue));
+    R_RegisterCFinalizerEx(xp, std_vector::Finalize, TRUE);
+    SEXP res = R_new_altrep(class_t, xp, R_NilValue);
+    UNPROTECT(1);
+    return res;
+  }
+
+  // finalizer for the external pointer
+  static void Finalize(SEXP xp)
+  {
+    delete static_cast<std::vector<T>*>(R_ExternalPtrAddr(xp));
+  }
+
+  static std::vector<T>& Get(SEXP vec)
+  {
+    return *static_cast<std::vector<T>*>(R_ExternalPtrAddr(R_altrep_data1(vec)));
+  }
+
+  // ALTREP methods -------------------
+  static R_xlen_t Length(SEXP vec)
+  {
+    return Get(vec).size();
+  }
+
+  static Rboolean Inspect(SEXP x, int pre, int deep, int pvec, void (*inspect_subtree)(SEXP, int, int, int))
+  {
+    Rprintf("std vector (%s) of length %lld\n", std::is_same<T, double>::value ? "double" : "int", (long long)Length(x));
+    return TRUE;
+  }
+
+  // ALTVEC methods ------------------
+  static void* Dataptr(SEXP vec, Rboolean writeable)
+  {
+    return Get(vec).data();
+  }
+
+  static const void* Dataptr_or_null(SEXP vec)
+  {
+    return Get(vec).data();
+  }
+
+  // ALTINT and ALTREAL methods -----------------
+  static T Elt(SEXP vec, R_xlen_t i)
+  {
+    return Get(vec)[i];
+  }
+
+  static R_xlen_t Get_region(SEXP vec, R_xlen_t start, R_xlen_t size, T* out)
+  {
+    R_xlen_t n = Length(vec);
+    R_xlen_t ncopy = (start + size > n) ? n - start : size;
+    if (ncopy <= 0) return 0;
+    memcpy(out, Get(vec).data() + start, ncopy * sizeof(T));
+    return ncopy;
+  }
+
+  // -------- initialize the altrep class with the methods above
+  static void Init(DllInfo* dll)
+  {
+    R_altrep_class_t class_t;
+
+    if (std::is_same<T, double>::value)
+    {
+      class_t = R_make_altreal_class("std vector (double)", "rlas", dll);
+      std_vector_real = class_t;
+    }
+    else
+    {
+      class_t = R_make_altinteger_class("std vector (int)", "rlas", dll);
+      std_vector_integer = class_t;
+    }
+
+    // altrep
+    R_set_altrep_Length_method(class_t, Length);
+    R_set_altrep_Inspect_method(class_t, Inspect);
+
+    // altvec
+    R_set_altvec_Dataptr_method(class_t, Dataptr);
+    R_set_altvec_Dataptr_or_null_method(class_t, Dataptr_or_null);
+  }
+};
+
+SEXP std_vector_make(std::vector<double>& x) { return std_vector<double>::Make(x); }
+SEXP std_vector_make(std::vector<int>& x) { return std_vector<int>::Make(x); }
+
+// [[Rcpp::init]]
+void init_altrep_vector(DllInfo* dll)
+{
+  std_vector<double>::Init(dll);
+  R_set_altreal_Elt_method(std_vector_real, std_vector<double>::Elt);
+  R_set_altreal_Get_region_method(std_vector_real, std_vector<double>::Get_region);
+
+  std_vector<int>::Init(dll);
+  R_set_altinteger_Elt_method(std_vector_integer, std_vector<int>::Elt);
+  R_set_altinteger_Get_region_method(std_vector_integer, std_vector<int>::Get_region);
+}
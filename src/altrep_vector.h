@@ -0,0 +1,12 @@
+#ifndef ALTREP_VECTOR_H
+#define ALTREP_VECTOR_H
+
+#include <Rinternals.h>
+#include <vector>
+
+// Numeric and integer vectors that own a std::vector. The memory of the std::vector is moved into
+// the ALTREP object without copy. See altrep_vector.cpp
+SEXP std_vector_make(std::vector<double>& x);
+SEXP std_vector_make(std::vector<int>& x);
+
+#endif //ALTREP_VECTOR_H
@@ -1,6 +1,32 @@
 #include <Rcpp.h>
+#include <inttypes.h>
+#include <vector>
+
+#include "rlasthreads.h"
+
 using namespace Rcpp;
 
+static inline unsigned int decimal_count(double x)
+{
+  // modified from https://stackoverflow.com/a/63215955/8442410
+  unsigned int count = 0;
+  double v = std::abs(x);
+  double c = v - std::floor(v);
+  double factor = 10;
+  double eps = std::numeric_limits<double>::epsilon() * c;
+
+  while ((c > eps && c < (1 - eps)) && count < 8)
+  {
+    c = v * factor;
+    c = c - std::floor(c);
+    factor *= 10;
+    eps = std::numeric_limits<double>::epsilon() * v * factor;
+    count++;
+  }
+
+  return count;
+}
+
 // [[Rcpp::export]]
 int fast_countequal(IntegerVector x, int t)
 {
@@ -25,25 +51,93 @@ IntegerVector fast_decimal_count(NumericVector x)
   IntegerVector y(x.size());
 
   for (auto i = 0 ; i < x.size() ; i++)
+    y[i] = decimal_count(x[i]);
+
+  return y;
+}
+
+// Everything header_create() and header_update() need to know about the coordinates in a single
+// parallel pass: the number of points, the bounding box, the number of points by return and the
+// distribution of the number of decimals of X, Y and Z used to infer the scale factors.
+// [[Rcpp::export]]
+List fast_header_inventory(NumericVector X, NumericVector Y, NumericVector Z, IntegerVector ReturnNumber)
+{
+  R_xlen_t n = X.size();
+  const double* xyz[3] = {X.begin(), Y.begin(), Z.begin()};
+  const int* rn = (ReturnNumber.size() == n) ? ReturnNumber.begin() : NULL;
+
+  double min[3] = {R_PosInf, R_PosInf, R_PosInf};
+  double max[3] = {R_NegInf, R_NegInf, R_NegInf};
+  bool na[3] = {false, false, false};
+  std::vector<double> returns(16, 0);
+  std::vector<double> decimals(3*9, 0);
+
+  #pragma omp parallel num_threads(rlas_threads())
   {
-    // modified from https://stackoverflow.com/a/63215955/8442410
-    unsigned int count = 0;
-    double v = std::abs(x[i]);
-    double c = v - std::floor(v);
-    double factor = 10;
-    double eps = std::numeric_limits<double>::epsilon() * c;
-
-    while ((c > eps && c < (1 - eps)) && count < 8)
+    double tmin[3] = {R_PosInf, R_PosInf, R_PosInf};
+    double tmax[3] = {R_NegInf, R_NegInf, R_NegInf};
+    bool tna[3] = {false, false, false};
+    uint64_t treturns[16] = {0};
+    uint64_t tdecimals[3*9] = {0};
+
+    #pragma omp for nowait
+    for (R_xlen_t i = 0 ; i < n ; i++)
+    {
+      for (int k = 0 ; k < 3 ; k++)
+      {
+        double v = xyz[k][i];
+        if (v != v) { tna[k] = true; continue; }
+        if (v < tmin[k]) tmin[k] = v;
+        if (v > tmax[k]) tmax[k] = v;
+        tdecimals[k*9 + decimal_count(v)]++;
+      }
+
+      if (rn && rn[i] >= 0 && rn[i] < 16) treturns[rn[i]]++;
+    }
+
+    #pragma omp critical
     {
-      c = v * factor;
-      c = c - std::floor(c);
-      factor *= 10;
-      eps = std::numeric_limits<double>::epsilon() * v * factor;
-      count++;
+      for (int k = 0 ; k < 3 ; k++)
+      {
+        if (tmin[k] < min[k]) min[k] = tmin[k];
+        if (tmax[k] > max[k]) max[k] = tmax[k];
+        na[k] = na[k] || tna[k];
+      }
+      for (int k = 0 ; k < 16 ; k++) returns[k] += treturns[k];
+      for (int k = 0 ; k < 3*9 ; k++) decimals[k] += tdecimals[k];
     }
+  }
 
-    y[i] = count;
+  // Same as min() and max() in R
+  for (int k = 0 ; k < 3 ; k++)
+  {
+    if (na[k]) min[k] = max[k] = NA_REAL;
   }
 
-  return y;
+  // Number of coordinates with 0 to 8 decimals (8 meaning 8 or more) in columns X, Y, Z
+  NumericVector dec(decimals.begin(), decimals.end());
+  dec.attr("dim") = IntegerVector::create(9, 3);
+  dec.attr("dimnames") = List::create(R_NilValue, CharacterVector::create("X", "Y", "Z"));
+
+  return List::create(_["n"] = (double)n,
+                      _["min"] = NumericVector(min, min+3),
+                      _["max"] = NumericVector(max, max+3),
+                      _["returns"] = NumericVector(returns.begin(), returns.end()),
+                      _["decimals"] = dec);
+}
+
+// [[Rcpp::export]]
+std::string fast_hash(std::string x)
+{
+  // 64 bits FNV-1a. Not cryptographic, only used to name cache files.
+  uint64_t h = 14695981039346656037ULL;
+  for (unsigned char c : x)
+  {
+    h ^= c;
+    h *= 1099511628211ULL;
+  }
+
+  char buffer[17];
+  snprintf(buffer, sizeof(buffer), "%016" PRIx64, h);
+  return std::string(buffer);
 }
@@ -31,6 +31,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>
 #include <chrono>
 #include <string>
 #include "rlasstreamer.h"
+#include "rlasarrow.h"
 #include "laspoint.hpp"
 #include "lasreader.hpp"
 #include "laswriter.hpp"
@@ -73,13 +74,96 @@ inline void print_progress(float progress, const std::chrono::steady_clock::time
               << "ETA: " << static_cast<int>(eta) << "s     " << std::flush;
 }
 
+void read_points(RLASstreamer& streamer, Rcpp::List polygons);
+
+// Attributes stored on 8 or 16 bits in the files are returned as narrow ALTREP integers
+// if options(rlas.narrow_integers = TRUE)
+static bool narrow_integers()
+{
+  return Rf_asLogical(Rf_GetOption1(Rf_install("rlas.narrow_integers"))) == TRUE;
+}
+
+// Coordinates and gpstime are returned as block compressed ALTREP vectors
+// if options(rlas.block_compression = TRUE)
+static bool block_compression()
+{
+  return Rf_asLogical(Rf_GetOption1(Rf_install("rlas.block_compression"))) == TRUE;
+}
+
 // [[Rcpp::export]]
-List C_reader(CharacterVector ifiles, CharacterVector ofile, CharacterVector select, CharacterVector filter, Rcpp::List polygons)
+List C_reader(CharacterVector ifiles, CharacterVector ofile, CharacterVector select, CharacterVector filter, CharacterVector sort, Rcpp::List polygons)
 {
   RLASstreamer streamer(ifiles, ofile, filter);
   streamer.select(select);
+  streamer.setsort(sort);
+  streamer.setnarrow(narrow_integers());
+  streamer.setcompression(block_compression());
+  streamer.allocation();
+  read_points(streamer, polygons);
+  return streamer.terminate();
+}
+
+// [[Rcpp::export]]
+List C_reader_arrow(CharacterVector ifiles, CharacterVector select, CharacterVector filter, CharacterVector sort, Rcpp::List polygons)
+{
+  RLASstreamer streamer(ifiles, CharacterVector::create(""), filter);
+  streamer.select(select);
+  streamer.setsort(sort);
+  streamer.allocation();
+  read_points(streamer, polygons);
+
+  // The structs are owned by R. Their content is owned by the release callbacks and is
+  // either moved by the consumer or released when the external pointers are garbage collected.
+  ArrowSchema* schema = new ArrowSchema;
+  schema->release = NULL;
+  XPtr<ArrowSchema, PreserveStorage, arrow_schema_delete, true> xschema(schema, true);
+
+  ArrowArray* array = new ArrowArray;
+  array->release = NULL;
+  XPtr<ArrowArray, PreserveStorage, arrow_array_delete, true> xarray(array, true);
+
+  streamer.terminate(schema, array);
+
+  return List::create(_["schema"] = xschema, _["array"] = xarray);
+}
+
+// [[Rcpp::export]]
+void C_reader_columnar(CharacterVector ifiles, CharacterVector select, CharacterVector filter, CharacterVector sort, Rcpp::List polygons, CharacterVector ofile, CharacterVector key)
+{
+  RLASstreamer streamer(ifiles, CharacterVector::create(""), filter);
+  streamer.select(select);
+  streamer.setsort(sort);
+  streamer.allocation();
+  read_points(streamer, polygons);
+  streamer.terminate(as<std::string>(ofile), as<std::string>(key));
+}
+
+// [[Rcpp::export]]
+List C_reader_matrix(CharacterVector ifiles, CharacterVector select, CharacterVector filter, CharacterVector sort, Rcpp::List polygons, bool quantized)
+{
+  RLASstreamer streamer(ifiles, CharacterVector::create(""), filter);
+  streamer.select(select);
+  streamer.setsort(sort);
+  streamer.setnarrow(narrow_integers());
+  streamer.setcompression(block_compression());
+  streamer.setinterleaved(quantized);
   streamer.allocation();
+  read_points(streamer, polygons);
+  return streamer.terminate();
+}
+
+// [[Rcpp::export]]
+List C_memory_estimate(CharacterVector ifiles, CharacterVector select, CharacterVector filter, CharacterVector sort, int sample)
+{
+  RLASstreamer streamer(ifiles, CharacterVector::create(""), filter);
+  streamer.select(select);
+  streamer.setsort(sort);
+  streamer.setnarrow(narrow_integers());
+  return streamer.memory_estimate(sample);
+}
 
+void read_points(RLASstreamer& streamer, Rcpp::List polygons)
+{
   auto start = std::chrono::steady_clock::now();
   int counter = 0;
 
@@ -148,6 +232,4 @@ List C_reader(CharacterVector ifiles, CharacterVector ofile, CharacterVector sel
   }
 
   Rcpp::Rcout << "\r" << std::string(80, ' ') << "\r" << std::flush;
-
-  return streamer.terminate();
 }
\ No newline at end of file
@@ -32,6 +32,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 
 #include "lasreader.hpp"
 #include "lasfilter.hpp"
@@ -45,6 +46,24 @@ List evlrsreader(LASheader*);
 List globalencodingreader(LASheader*);
 inline std::string nullterminate(CHAR*, int);
 
+// Point counts are integers unless they exceed the range of R integers
+static SEXP point_count(U64 n)
+{
+  if (n > (U64)INT_MAX) return wrap((double)n);
+  return wrap((int)n);
+}
+
+template<typename T> static SEXP point_counts(const T* n, int size)
+{
+  for (int i = 0 ; i < size ; i++)
+  {
+    if ((U64)n[i] > (U64)INT_MAX)
+      return NumericVector(n, n + size);
+  }
+
+  return IntegerVector(n, n + size);
+}
+
 // Read header in a las or laz file
 //
 // Read data from a las  or laz file in format 1 to 4 according to LAS specification and return a list.
@@ -100,24 +119,13 @@ List lasheaderreader(CharacterVector file)
     // Added support of LAS 1.4
     if (lasheader->version_minor == 4)
     {
-      if (lasheader->extended_number_of_point_records > 2147483647)
-        throw std::runtime_error("R cannot handle more than 2147483647 points.");
-
-      head.push_back((int)lasheader->extended_number_of_point_records);
-      IntegerVector extended_number_of_points_by_return(15);
-      for(int i = 0 ; i < 15 ; i++) extended_number_of_points_by_return[i] = (int)lasheader->extended_number_of_points_by_return[i];
-      head.push_back(extended_number_of_points_by_return);
+      head.push_back(point_count(lasheader->extended_number_of_point_records));
+      head.push_back(point_counts(lasheader->extended_number_of_points_by_return, 15));
     }
     else
     {
-      if (lasheader->number_of_point_records > 2147483647)
-        throw std::runtime_error("R cannot handle more than 2147483647 points.");
-
-      head.push_back((int)lasheader->number_of_point_records);
-
-      IntegerVector number_of_points_by_return(5);
-      for(int i = 0 ; i < 5 ; i++) number_of_points_by_return[i] = (int)lasheader->number_of_points_by_return[i];
-      head.push_back(number_of_points_by_return);
+      head.push_back(point_count(lasheader->number_of_point_records));
+      head.push_back(point_counts(lasheader->number_of_points_by_return, 5));
     }
 
     head.push_back(lasheader->x_scale_factor);
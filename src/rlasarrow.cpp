@@ -0,0 +1,409 @@
+#include "rlasarrow.h"
+
+#include <string.h>
+#include <stdexcept>
+#include <type_traits>
+
+// ===============================
+// Export
+// ===============================
+
+// Arrow format string of a C++ type
+template<typename T> const char* arrow_format()
+{
+  if (std::is_same<T, double>::value) return "g";
+  if (std::is_same<T, float>::value) return "f";
+
+  if (std::is_signed<T>::value)
+  {
+    switch (sizeof(T))
+    {
+      case 1: return "c";
+      case 2: return "s";
+      case 4: return "i";
+      case 8: return "l";
+    }
+  }
+  else
+  {
+    switch (sizeof(T))
+    {
+      case 1: return "C";
+      case 2: return "S";
+      case 4: return "I";
+      case 8: return "L";
+    }
+  }
+
+  throw std::runtime_error("Type not supported in Arrow export");
+}
+
+// Owns the buffers of an exported child array. Buffer 0 is the validity bitmap (may be null)
+// buffer 1 is the data.
+struct ArrowArrayData
+{
+  virtual ~ArrowArrayData() {};
+  const void* buffers[2];
+  std::vector<uint8_t> validity;
+};
+
+template<typename T> struct ArrowArrayVector : public ArrowArrayData
+{
+  std::vector<T> values;
+};
+
+// Owns the strings and the children of an exported schema
+struct ArrowSchemaData
+{
+  std::string format;
+  std::string name;
+  std::vector<ArrowSchema*> children;
+};
+
+// Owns the children of the exported struct array
+struct ArrowStructData
+{
+  const void* buffers[1];
+  std::vector<ArrowArray*> children;
+};
+
+static void release_schema(ArrowSchema* schema)
+{
+  ArrowSchemaData* data = (ArrowSchemaData*)schema->private_data;
+
+  for (ArrowSchema* child : data->children)
+  {
+    if (child->release) child->release(child);
+    delete child;
+  }
+
+  delete data;
+  schema->release = NULL;
+}
+
+static void release_array(ArrowArray* array)
+{
+  delete (ArrowArrayData*)array->private_data;
+  array->release = NULL;
+}
+
+static void release_struct_array(ArrowArray* array)
+{
+  ArrowStructData* data = (ArrowStructData*)array->private_data;
+
+  for (ArrowArray* child : data->children)
+  {
+    if (child->release) child->release(child);
+    delete child;
+  }
+
+  delete data;
+  array->release = NULL;
+}
+
+static void set_bit(std::vector<uint8_t>& bitmap, int64_t i, bool b)
+{
+  if (b)
+    bitmap[i >> 3] |= (uint8_t)(1 << (i & 7));
+  else
+    bitmap[i >> 3] &= (uint8_t)~(1 << (i & 7));
+}
+
+RLASArrowExporter::RLASArrowExporter(int64_t length)
+{
+  this->length = length;
+}
+
+RLASArrowExporter::~RLASArrowExporter()
+{
+  // Columns that were added but never finalized (e.g. an error occured)
+  for (ArrowSchema* schema : schemas)
+  {
+    if (schema->release) schema->release(schema);
+    delete schema;
+  }
+
+  for (ArrowArray* array : arrays)
+  {
+    if (array->release) array->release(array);
+    delete array;
+  }
+}
+
+template<typename T> void RLASArrowExporter::add(const std::string& name, std::vector<T>& x)
+{
+  ArrowArrayVector<T>* data = new ArrowArrayVector<T>;
+
+  // Attributes not populated are stored with a single value by the streamer
+  if (x.size() == 1 && length > 1)
+    data->values.assign(length, x[0]);
+  else
+    data->values.swap(x);
+
+  data->buffers[0] = NULL;
+  data->buffers[1] = data->values.data();
+
+  ArrowSchema* schema = new ArrowSchema;
+  ArrowArray* array = new ArrowArray;
+  array->private_data = data;
+  array->null_count = 0;
+  push(name, arrow_format<T>(), schema, array);
+}
+
+template<typename T> void RLASArrowExporter::add(const std::string& name, std::vector<T>& x, T na)
+{
+  add(name, x);
+
+  ArrowArray* array = arrays.back();
+  ArrowArrayVector<T>* data = (ArrowArrayVector<T>*)array->private_data;
+
+  int64_t null_count = 0;
+  std::vector<uint8_t> validity((length+7)/8, 0xFF);
+  for (int64_t i = 0 ; i < length ; i++)
+  {
+    T v = data->values[i];
+    if (v == na || v != v) // v != v is true for NaN
+    {
+      set_bit(validity, i, false);
+      null_count++;
+    }
+  }
+
+  if (null_count > 0)
+  {
+    data->validity.swap(validity);
+    data->buffers[0] = data->validity.data();
+    array->null_count = null_count;
+    schemas.back()->flags |= ARROW_FLAG_NULLABLE;
+  }
+}
+
+void RLASArrowExporter::add(const std::string& name, const std::vector<bool>& x)
+{
+  // std::vector<bool> is bit packed but its layout is not accessible. Arrow booleans are
+  // bit packed too so the copy costs 1 bit per point.
+  ArrowArrayVector<uint8_t>* data = new ArrowArrayVector<uint8_t>;
+  data->values.assign((length+7)/8, 0);
+
+  bool single = x.size() == 1;
+  for (int64_t i = 0 ; i < length ; i++)
+    set_bit(data->values, i, single ? x[0] : x[i]);
+
+  data->buffers[0] = NULL;
+  data->buffers[1] = data->values.data();
+
+  ArrowSchema* schema = new ArrowSchema;
+  ArrowArray* array = new ArrowArray;
+  array->private_data = data;
+  array->null_count = 0;
+  push(name, "b", schema, array);
+}
+
+void RLASArrowExporter::push(const std::string& name, const char* format, ArrowSchema* schema, ArrowArray* array)
+{
+  ArrowSchemaData* sdata = new ArrowSchemaData;
+  sdata->format = format;
+  sdata->name = name;
+
+  schema->format = sdata->format.c_str();
+  schema->name = sdata->name.c_str();
+  schema->metadata = NULL;
+  schema->flags = 0;
+  schema->n_children = 0;
+  schema->children = NULL;
+  schema->dictionary = NULL;
+  schema->release = release_schema;
+  schema->private_data = sdata;
+
+  array->length = length;
+  array->offset = 0;
+  array->n_buffers = 2;
+  array->n_children = 0;
+  array->buffers = ((ArrowArrayData*)array->private_data)->buffers;
+  array->children = NULL;
+  array->dictionary = NULL;
+  array->release = release_array;
+
+  schemas.push_back(schema);
+  arrays.push_back(array);
+}
+
+void RLASArrowExporter::finalize(ArrowSchema* schema, ArrowArray* array)
+{
+  ArrowSchemaData* sdata = new ArrowSchemaData;
+  sdata->format = "+s";
+  sdata->name = "";
+  sdata->children.swap(schemas);
+
+  schema->format = sdata->format.c_str();
+  schema->name = sdata->name.c_str();
+  schema->metadata = NULL;
+  schema->flags = 0;
+  schema->n_children = sdata->children.size();
+  schema->children = sdata->children.data();
+  schema->dictionary = NULL;
+  schema->release = release_schema;
+  schema->private_data = sdata;
+
+  ArrowStructData* adata = new ArrowStructData;
+  adata->buffers[0] = NULL;
+  adata->children.swap(arrays);
+
+  array->length = length;
+  array->null_count = 0;
+  array->offset = 0;
+  array->n_buffers = 1;
+  array->n_children = adata->children.size();
+  array->buffers = adata->buffers;
+  array->children = adata->children.data();
+  array->dictionary = NULL;
+  array->release = release_struct_array;
+  array->private_data = adata;
+}
+
+template void RLASArrowExporter::add<double>(const std::string&, std::vector<double>&);
+template void RLASArrowExporter::add<float>(const std::string&, std::vector<float>&);
+template void RLASArrowExporter::add<int>(const std::string&, std::vector<int>&);
+template void RLASArrowExporter::add<short>(const std::string&, std::vector<short>&);
+template void RLASArrowExporter::add<unsigned char>(const std::string&, std::vector<unsigned char>&);
+template void RLASArrowExporter::add<unsigned short>(const std::string&, std::vector<unsigned short>&);
+template void RLASArrowExporter::add<unsigned int>(const std::string&, std::vector<unsigned int>&);
+template void RLASArrowExporter::add<uint64_t>(const std::string&, std::vector<uint64_t>&);
+template void RLASArrowExporter::add<int>(const std::string&, std::vector<int>&, int);
+template void RLASArrowExporter::add<double>(const std::string&, std::vector<double>&, double);
+
+// ===============================
+// Import
+// ===============================
+
+RLASArrowColumn::RLASArrowColumn()
+{
+  type = 0;
+  offset = 0;
+  validity = NULL;
+  data = NULL;
+}
+
+RLASArrowColumn::RLASArrowColumn(const ArrowSchema* schema, const ArrowArray* array, int64_t parent_offset)
+{
+  name = (schema->name) ? schema->name : "";
+  type = (strlen(schema->format) == 1 && schema->dictionary == NULL) ? schema->format[0] : 0;
+  offset = array->offset + parent_offset;
+  validity = (array->n_buffers > 0 && array->null_count != 0) ? (const uint8_t*)array->buffers[0] : NULL;
+  data = (array->n_buffers > 1) ? array->buffers[1] : NULL;
+}
+
+bool RLASArrowColumn::is_supported() const
+{
+  switch (type)
+  {
+    case 'b': case 'c': case 'C': case 's': case 'S': case 'i': case 'I':
+    case 'l': case 'L': case 'f': case 'g': return data != NULL;
+    default: return false;
+  }
+}
+
+bool RLASArrowColumn::is_na(int64_t i) const
+{
+  if (validity == NULL) return false;
+  i += offset;
+  return !(validity[i >> 3] & (1 << (i & 7)));
+}
+
+// Whether one of the first 'length' values is null. The null count of an array may be unknown (-1)
+// so the validity bitmap is read.
+bool RLASArrowColumn::has_na(int64_t length) const
+{
+  if (validity == NULL) return false;
+  for (int64_t i = 0 ; i < length ; i++)
+    if (is_na(i)) return true;
+  return false;
+}
+
+double RLASArrowColumn::get_double(int64_t i) const
+{
+  i += offset;
+
+  switch (type)
+  {
+    case 'b': return (((const uint8_t*)data)[i >> 3] >> (i & 7)) & 1;
+    case 'c': return ((const int8_t*)data)[i];
+    case 'C': return ((const uint8_t*)data)[i];
+    case 's': return ((const int16_t*)data)[i];
+    case 'S': return ((const uint16_t*)data)[i];
+    case 'i': return ((const int32_t*)data)[i];
+    case 'I': return ((const uint32_t*)data)[i];
+    case 'l': return (double)((const int64_t*)data)[i];
+    case 'L': return (double)((const uint64_t*)data)[i];
+    case 'f': return ((const float*)data)[i];
+    case 'g': return ((const double*)data)[i];
+    default: throw std::runtime_error("Arrow type not supported");
+  }
+}
+
+int64_t RLASArrowColumn::get_int(int64_t i) const
+{
+  i += offset;
+
+  switch (type)
+  {
+    case 'b': return (((const uint8_t*)data)[i >> 3] >> (i & 7)) & 1;
+    case 'c': return ((const int8_t*)data)[i];
+    case 'C': return ((const uint8_t*)data)[i];
+    case 's': return ((const int16_t*)data)[i];
+    case 'S': return ((const uint16_t*)data)[i];
+    case 'i': return ((const int32_t*)data)[i];
+    case 'I': return ((const uint32_t*)data)[i];
+    case 'l': return ((const int64_t*)data)[i];
+    case 'L': return (int64_t)((const uint64_t*)data)[i];
+    case 'f': return (int64_t)((const float*)data)[i];
+    case 'g': return (int64_t)((const double*)data)[i];
+    default: throw std::runtime_error("Arrow type not supported");
+  }
+}
+
+bool arrow_find_column(const ArrowSchema* schema, const ArrowArray* array, const char* name, RLASArrowColumn& column)
+{
+  if (array->n_children != schema->n_children)
+    throw std::runtime_error("The Arrow array does not match its schema.");
+
+  for (int64_t i = 0 ; i < schema->n_children ; i++)
+  {
+    const ArrowSchema* child = schema->children[i];
+
+    if (child->name && strcmp(child->name, name) == 0)
+    {
+      // A struct array may be sliced: the offset of the parent applies to its children
+      column = RLASArrowColumn(child, array->children[i], array->offset);
+
+      if (!column.is_supported())
+        throw std::runtime_error(std::string("Arrow format '") + child->format + "' of column " + name + " not supported.");
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+std::vector<std::string> arrow_column_names(const ArrowSchema* schema)
+{
+  std::vector<std::string> names;
+  for (int64_t i = 0 ; i < schema->n_children ; i++)
+    names.push_back(schema->children[i]->name ? schema->children[i]->name : "");
+  return names;
+}
+
+void arrow_schema_delete(ArrowSchema* schema)
+{
+  if (schema == NULL) return;
+  if (schema->release) schema->release(schema);
+  delete schema;
+}
+
+void arrow_array_delete(ArrowArray* array)
+{
+  if (array == NULL) return;
+  if (array->release) array->release(array);
+  delete array;
+}
@@ -0,0 +1,103 @@
+#ifndef RLASARROW_H
+#define RLASARROW_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Arrow C data interface (https://arrow.apache.org/docs/format/CDataInterface.html)
+// The ABI is stable and meant to be copied verbatim so rlas can exchange columns
+// with Arrow based tools without depending on the Arrow library.
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+  // Array type description
+  const char* format;
+  const char* name;
+  const char* metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema** children;
+  struct ArrowSchema* dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowSchema*);
+  // Opaque producer-specific data
+  void* private_data;
+};
+
+struct ArrowArray {
+  // Array data description
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void** buffers;
+  struct ArrowArray** children;
+  struct ArrowArray* dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowArray*);
+  // Opaque producer-specific data
+  void* private_data;
+};
+
+#endif  // ARROW_C_DATA_INTERFACE
+
+// Builds a struct array (a record batch) whose children are the columns of a point
+// cloud. Column buffers are moved into the exported arrays so the memory is owned by
+// the release callbacks and not by rlas nor by R.
+class RLASArrowExporter
+{
+public:
+  RLASArrowExporter(int64_t length);
+  ~RLASArrowExporter();
+  template<typename T> void add(const std::string& name, std::vector<T>& x);
+  template<typename T> void add(const std::string& name, std::vector<T>& x, T na);
+  void add(const std::string& name, const std::vector<bool>& x);
+  void finalize(ArrowSchema* schema, ArrowArray* array);
+
+private:
+  void push(const std::string& name, const char* format, ArrowSchema* schema, ArrowArray* array);
+
+  int64_t length;
+  std::vector<ArrowSchema*> schemas;
+  std::vector<ArrowArray*> arrays;
+};
+
+// A read only view on a primitive child array of an imported struct array.
+class RLASArrowColumn
+{
+public:
+  RLASArrowColumn();
+  RLASArrowColumn(const ArrowSchema* schema, const ArrowArray* array, int64_t parent_offset = 0);
+  bool is_supported() const;
+  bool is_na(int64_t i) const;
+  bool has_na(int64_t length) const;
+  double get_double(int64_t i) const;
+  int64_t get_int(int64_t i) const;
+
+  std::string name;
+
+private:
+  char type;
+  int64_t offset;
+  const uint8_t* validity;
+  const void* data;
+};
+
+// Find the children of an imported struct array by name
+bool arrow_find_column(const ArrowSchema* schema, const ArrowArray* array, const char* name, RLASArrowColumn& column);
+std::vector<std::string> arrow_column_names(const ArrowSchema* schema);
+
+// Release the memory of the structs allocated for R external pointers
+void arrow_schema_delete(ArrowSchema* schema);
+void arrow_array_delete(ArrowArray* array);
+
+#endif //RLASARROW_H
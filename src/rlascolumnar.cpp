@@ -0,0 +1,364 @@
+#include "rlascolumnar.h"
+
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// Size of the fixed part of the header: magic, version, ncol, npoints, directory offset, key size
+#define HEADER_SIZE (8 + 4 + 4 + 8 + 8 + 8)
+
+// ===============================
+// Writer
+// ===============================
+
+static std::string temporary_path(const std::string& path)
+{
+#ifdef _WIN32
+  unsigned long pid = (unsigned long)GetCurrentProcessId();
+#else
+  unsigned long pid = (unsigned long)getpid();
+#endif
+
+  std::random_device device;
+  uint64_t suffix = ((uint64_t)device() << 32) | device();
+
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), ".%lu.%016llx.tmp", pid, (unsigned long long)suffix);
+  return path + buffer;
+}
+
+RLASColumnarWriter::RLASColumnarWriter(const std::string& path, const std::string& key, uint64_t npoints)
+{
+  // Write in a temporary file renamed on close so a reader never maps an incomplete file and
+  // processes that already mapped a previous version of the file keep a valid mapping. The name of
+  // the temporary file is unique so concurrent writers of the same cache never share it.
+  this->path = path;
+  this->tmppath = temporary_path(path);
+  this->key = key;
+  this->npoints = npoints;
+  this->position = 0;
+
+  file = fopen(tmppath.c_str(), "wb");
+  if (file == NULL)
+    throw std::runtime_error(std::string("Cannot open file ") + tmppath + " for writing.");
+
+  // Placeholder header. The number of columns and the directory offset are written on close.
+  std::vector<char> header(HEADER_SIZE, 0);
+  write(header.data(), header.size());
+  write(key.data(), key.size());
+}
+
+RLASColumnarWriter::~RLASColumnarWriter()
+{
+  // Not closed: an error occurred. The incomplete file is removed.
+  if (file)
+  {
+    fclose(file);
+    remove(tmppath.c_str());
+  }
+}
+
+void RLASColumnarWriter::write(const void* buffer, uint64_t size)
+{
+  if (size == 0) return;
+
+  if (fwrite(buffer, 1, size, file) != size)
+    throw std::runtime_error(std::string("Cannot write into ") + tmppath + ". Is the disk full?");
+
+  position += size;
+}
+
+void RLASColumnarWriter::align()
+{
+  static const char zeros[64] = {0};
+  uint64_t padding = (64 - position % 64) % 64;
+  write(zeros, padding);
+}
+
+template<typename R, typename T> void RLASColumnarWriter::write_column(const std::string& name, RLASColumnType type, std::vector<T>& x)
+{
+  // Attributes not populated are stored with a single value by the streamer
+  uint64_t length = (x.size() == 1) ? 1 : npoints;
+
+  if (x.size() != length)
+    throw std::runtime_error(std::string("Column ") + name + " has an incorrect length.");
+
+  align();
+
+  RLASColumnEntry entry;
+  entry.name = name;
+  entry.type = type;
+  entry.length = length;
+  entry.offset = position;
+  entries.push_back(entry);
+
+  // Converted by blocks to the R type without allocating a full column
+  const uint64_t block = 65536;
+  std::vector<R> buffer(std::min(block, length));
+
+  for (uint64_t i = 0 ; i < length ; i += block)
+  {
+    uint64_t m = std::min(block, length - i);
+    for (uint64_t j = 0 ; j < m ; j++) buffer[j] = (R)x[i+j];
+    write(buffer.data(), m*sizeof(R));
+  }
+
+  // The column is now on disk. Release the memory.
+  x.clear();
+  x.shrink_to_fit();
+}
+
+template<typename T> void RLASColumnarWriter::add(const std::string& name, std::vector<T>& x)
+{
+  // Same conversions than Rcpp::wrap
+  bool dbl = std::is_floating_point<T>::value || (std::is_unsigned<T>::value && sizeof(T) >= 4);
+
+  if (dbl)
+    write_column<double>(name, RLAS_COLUMN_DOUBLE, x);
+  else
+    write_column<int>(name, RLAS_COLUMN_INT, x);
+}
+
+template<typename T> void RLASColumnarWriter::add(const std::string& name, std::vector<T>& x, T)
+{
+  // Values are already NA_INTEGER or NA_REAL which is the representation of NA in R
+  add(name, x);
+}
+
+void RLASColumnarWriter::add(const std::string& name, std::vector<bool>& x)
+{
+  write_column<int>(name, RLAS_COLUMN_LOGICAL, x);
+}
+
+void RLASColumnarWriter::close()
+{
+  align();
+
+  uint64_t directory = position;
+
+  for (const RLASColumnEntry& entry : entries)
+  {
+    uint64_t size = entry.name.size();
+    write(&size, 8);
+    write(entry.name.data(), size);
+    write(&entry.type, 8);
+    write(&entry.length, 8);
+    write(&entry.offset, 8);
+  }
+
+  char magic[8] = RLAS_COLUMNAR_MAGIC;
+  uint32_t version = RLAS_COLUMNAR_VERSION;
+  uint32_t ncol = entries.size();
+  uint64_t key_size = key.size();
+
+  if (fseek(file, 0, SEEK_SET) != 0)
+    throw std::runtime_error(std::string("Cannot write into ") + tmppath); // # nocov
+
+  write(magic, 8);
+  write(&version, 4);
+  write(&ncol, 4);
+  write(&npoints, 8);
+  write(&directory, 8);
+  write(&key_size, 8);
+
+  int err = fclose(file);
+  file = NULL;
+
+  if (err != 0)
+    throw std::runtime_error(std::string("Cannot write into ") + tmppath + ". Is the disk full?");
+
+#ifdef _WIN32
+  remove(path.c_str());
+#endif
+
+  if (rename(tmppath.c_str(), path.c_str()) != 0)
+  {
+    remove(tmppath.c_str());
+    throw std::runtime_error(std::string("Cannot create file ") + path);
+  }
+}
+
+template void RLASColumnarWriter::add<double>(const std::string&, std::vector<double>&);
+template void RLASColumnarWriter::add<float>(const std::string&, std::vector<float>&);
+template void RLASColumnarWriter::add<int>(const std::string&, std::vector<int>&);
+template void RLASColumnarWriter::add<short>(const std::string&, std::vector<short>&);
+template void RLASColumnarWriter::add<unsigned char>(const std::string&, std::vector<unsigned char>&);
+template void RLASColumnarWriter::add<unsigned short>(const std::string&, std::vector<unsigned short>&);
+template void RLASColumnarWriter::add<unsigned int>(const std::string&, std::vector<unsigned int>&);
+template void RLASColumnarWriter::add<uint64_t>(const std::string&, std::vector<uint64_t>&);
+template void RLASColumnarWriter::add<int>(const std::string&, std::vector<int>&, int);
+template void RLASColumnarWriter::add<double>(const std::string&, std::vector<double>&, double);
+
+// ===============================
+// Reader
+// ===============================
+
+static bool parse_header(const char* buffer, uint32_t& ncol, uint64_t& npoints, uint64_t& directory, uint64_t& key_size)
+{
+  uint32_t version;
+
+  if (memcmp(buffer, RLAS_COLUMNAR_MAGIC, 8) != 0) return false;
+  memcpy(&version, buffer + 8, 4);
+  memcpy(&ncol, buffer + 12, 4);
+  memcpy(&npoints, buffer + 16, 8);
+  memcpy(&directory, buffer + 24, 8);
+  memcpy(&key_size, buffer + 32, 8);
+  return version == RLAS_COLUMNAR_VERSION;
+}
+
+RLASColumnarFile::RLASColumnarFile(const std::string& path)
+{
+  this->path = path;
+  data = NULL;
+  size = 0;
+
+  // The mapping is private (copy-on-write): pages are shared with the page cache and with the
+  // other processes until R writes into a vector. The file itself is never modified.
+#ifdef _WIN32
+  hmap = NULL;
+  hfile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (hfile == INVALID_HANDLE_VALUE)
+    throw std::runtime_error(std::string("Cannot open file ") + path);
+
+  LARGE_INTEGER fsize;
+  GetFileSizeEx(hfile, &fsize);
+  size = fsize.QuadPart;
+
+  if (size >= HEADER_SIZE)
+  {
+    hmap = CreateFileMappingA(hfile, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (hmap != NULL) data = (char*)MapViewOfFile(hmap, FILE_MAP_COPY, 0, 0, 0);
+  }
+
+  if (data == NULL)
+  {
+    if (hmap) CloseHandle(hmap);
+    CloseHandle(hfile);
+    throw std::runtime_error(std::string("Cannot map file ") + path);
+  }
+#else
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1)
+    throw std::runtime_error(std::string("Cannot open file ") + path);
+
+  struct stat st;
+  if (fstat(fd, &st) == 0) size = st.st_size;
+
+  if (size >= HEADER_SIZE)
+  {
+    void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (ptr != MAP_FAILED) data = (char*)ptr;
+  }
+
+  // The mapping stays valid after the file descriptor is closed
+  ::close(fd);
+
+  if (data == NULL)
+    throw std::runtime_error(std::string("Cannot map file ") + path);
+#endif
+
+  try
+  {
+    uint32_t ncol;
+    uint64_t directory, key_size;
+
+    if (!parse_header(data, ncol, npoints, directory, key_size))
+      throw std::runtime_error(std::string("File ") + path + " is not a valid rlas columnar file.");
+
+    if (HEADER_SIZE + key_size > size || directory > size)
+      throw std::runtime_error(std::string("File ") + path + " is corrupted.");
+
+    key.assign(data + HEADER_SIZE, key_size);
+
+    uint64_t pos = directory;
+    for (uint32_t i = 0 ; i < ncol ; i++)
+    {
+      RLASColumnEntry entry;
+      uint64_t name_size;
+
+      if (pos + 8 > size) throw std::runtime_error(std::string("File ") + path + " is corrupted.");
+      memcpy(&name_size, data + pos, 8);
+      pos += 8;
+
+      if (pos + name_size + 24 > size) throw std::runtime_error(std::string("File ") + path + " is corrupted.");
+      entry.name.assign(data + pos, name_size);
+      pos += name_size;
+      memcpy(&entry.type, data + pos, 8);
+      memcpy(&entry.length, data + pos + 8, 8);
+      memcpy(&entry.offset, data + pos + 16, 8);
+      pos += 24;
+
+      uint64_t width = (entry.type == RLAS_COLUMN_DOUBLE) ? 8 : 4;
+      if (entry.offset + entry.length * width > directory)
+        throw std::runtime_error(std::string("File ") + path + " is corrupted.");
+
+      entries.push_back(entry);
+    }
+  }
+  catch (...)
+  {
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle(hmap);
+    CloseHandle(hfile);
+#else
+    munmap(data, size);
+#endif
+    throw;
+  }
+}
+
+RLASColumnarFile::~RLASColumnarFile()
+{
+#ifdef _WIN32
+  UnmapViewOfFile(data);
+  CloseHandle(hmap);
+  CloseHandle(hfile);
+#else
+  munmap(data, size);
+#endif
+}
+
+int RLASColumnarFile::find(const std::string& name) const
+{
+  for (size_t i = 0 ; i < entries.size() ; i++)
+  {
+    if (entries[i].name == name)
+      return i;
+  }
+
+  return -1;
+}
+
+bool RLASColumnarFile::read_key(const std::string& path, std::string& key)
+{
+  FILE* f = fopen(path.c_str(), "rb");
+  if (f == NULL) return false;
+
+  char buffer[HEADER_SIZE];
+  uint32_t ncol;
+  uint64_t npoints, directory, key_size;
+
+  bool valid = fread(buffer, 1, HEADER_SIZE, f) == HEADER_SIZE && parse_header(buffer, ncol, npoints, directory, key_size);
+
+  if (valid)
+  {
+    key.resize(key_size);
+    valid = fread(&key[0], 1, key_size, f) == key_size;
+  }
+
+  fclose(f);
+  return valid;
+}
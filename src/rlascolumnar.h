@@ -0,0 +1,91 @@
+#ifndef RLASCOLUMNAR_H
+#define RLASCOLUMNAR_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// A columnar file stores decoded point cloud columns in the memory layout of R (int and double)
+// so they can be memory mapped and used by R without any copy nor decoding. Several processes
+// mapping the same file share the same physical memory through the page cache.
+//
+// Layout (native endianness, the file is meant to be used on the host that wrote it)
+// - header: magic (8 bytes), version (u32), number of columns (u32), number of points (u64),
+//   offset of the directory (u64), size of the key (u64), key
+// - columns: each column starts on a 64 bytes boundary
+// - directory: for each column, size of the name (u64), name, type (u64), length (u64), offset (u64)
+//
+// The key is an arbitrary string used to identify the content of the file. A column of length 1
+// is a constant column.
+
+#define RLAS_COLUMNAR_MAGIC "RLASCOL"
+#define RLAS_COLUMNAR_VERSION 1
+
+enum RLASColumnType {RLAS_COLUMN_INT = 1, RLAS_COLUMN_DOUBLE = 2, RLAS_COLUMN_LOGICAL = 3};
+
+struct RLASColumnEntry
+{
+  std::string name;
+  uint64_t type;
+  uint64_t length;
+  uint64_t offset;
+};
+
+class RLASColumnarWriter
+{
+public:
+  RLASColumnarWriter(const std::string& path, const std::string& key, uint64_t npoints);
+  ~RLASColumnarWriter();
+  template<typename T> void add(const std::string& name, std::vector<T>& x);
+  template<typename T> void add(const std::string& name, std::vector<T>& x, T na);
+  void add(const std::string& name, std::vector<bool>& x);
+  void close();
+
+private:
+  void write(const void* buffer, uint64_t size);
+  void align();
+  template<typename R, typename T> void write_column(const std::string& name, RLASColumnType type, std::vector<T>& x);
+
+  FILE* file;
+  std::string path;
+  std::string tmppath;
+  std::string key;
+  uint64_t npoints;
+  uint64_t position;
+  std::vector<RLASColumnEntry> entries;
+};
+
+class RLASColumnarFile
+{
+public:
+  RLASColumnarFile(const std::string& path);
+  ~RLASColumnarFile();
+  uint64_t get_npoints() const { return npoints; };
+  const std::string& get_key() const { return key; };
+  const std::string& get_path() const { return path; };
+  int get_ncolumns() const { return (int)entries.size(); };
+  const std::string& get_name(int i) const { return entries[i].name; };
+  RLASColumnType get_type(int i) const { return (RLASColumnType)entries[i].type; };
+  uint64_t get_length(int i) const { return entries[i].length; };
+  void* get_data(int i) const { return data + entries[i].offset; };
+  int find(const std::string& name) const;
+
+  // Reads only the key without mapping the file
+  static bool read_key(const std::string& path, std::string& key);
+
+private:
+  std::string path;
+  std::string key;
+  uint64_t npoints;
+  uint64_t size;
+  char* data;
+  std::vector<RLASColumnEntry> entries;
+
+#ifdef _WIN32
+  void* hfile;
+  void* hmap;
+#endif
+};
+
+#endif //RLASCOLUMNAR_H
@@ -0,0 +1,161 @@
+#include "rlascopc.h"
+#include "rlassort.h"
+#include "rlasthreads.h"
+#include "laspoint.hpp"
+
+#include <string.h>
+#include <numeric>
+
+// The points are placed depth by depth. At a given depth the points that are not yet placed are
+// sorted by cell of the sampling grid: the sort is stable so the first point of a cell is the first
+// point of the data and stays in the octant, the other points go deeper. Then all the points are
+// sorted by octant. The permutations are stored on 32 bits unless the point cloud is larger.
+template<typename Index>
+static void copc_place(const LASheader& header, const EPToctree& octree, const I32* XYZ, size_t n, I32 max_depth, int bits, std::vector<size_t>& order, std::vector<RLASOctant>& octants)
+{
+  I32 grid_size = octree.get_gridsize();
+  int nthreads = rlas_threads();
+  std::vector<int8_t> depth(n, -1);
+  std::vector<Index> remaining(n);
+  std::iota(remaining.begin(), remaining.end(), 0);
+  std::vector<uint64_t> keys;
+  std::vector<Index> sorted;
+
+  for (I32 d = 0 ; d < max_depth && !remaining.empty() ; d++)
+  {
+    // The cell of a point in the grid of all the cells of this depth: d + bits bits per axis
+    int64_t m = remaining.size();
+    int shift = d + bits;
+    keys.resize(m);
+
+    #pragma omp parallel num_threads(nthreads)
+    {
+      LASpoint p;
+      p.init(&header, header.point_data_format, header.point_data_record_length, &header);
+
+      #pragma omp for schedule(static)
+      for (int64_t j = 0 ; j < m ; j++)
+      {
+        const I32* q = XYZ + 3*(size_t)remaining[j];
+        p.X = q[0];
+        p.Y = q[1];
+        p.Z = q[2];
+        EPTkey key = octree.get_key(&p, d);
+        I32 cell = octree.get_cell(&p, key);
+        uint64_t x = ((uint64_t)key.x << bits) | (uint64_t)(cell % grid_size);
+        uint64_t y = ((uint64_t)key.y << bits) | (uint64_t)((cell / grid_size) % grid_size);
+        uint64_t z = ((uint64_t)key.z << bits) | (uint64_t)(cell / (grid_size*grid_size));
+        keys[j] = (x << 2*shift) | (y << shift) | z;
+      }
+    }
+
+    radix_sort(keys, sorted);
+
+    for (int64_t j = 0 ; j < m ; j++)
+    {
+      if (j == 0 || keys[j] != keys[j-1])
+        depth[remaining[sorted[j]]] = (int8_t)d;
+    }
+
+    // The points that go deeper, in the order of the data
+    size_t k = 0;
+    for (int64_t j = 0 ; j < m ; j++)
+    {
+      if (depth[remaining[j]] < 0)
+        remaining[k++] = remaining[j];
+    }
+    remaining.resize(k);
+  }
+
+  std::vector<Index>().swap(remaining);
+
+  // Octants by depth so a reader gets the coarse levels first, then by x, y and z. The points keep
+  // their relative order in an octant. The coordinates of an octant of depth d fit on d bits.
+  keys.resize(n);
+
+  #pragma omp parallel num_threads(nthreads)
+  {
+    LASpoint p;
+    p.init(&header, header.point_data_format, header.point_data_record_length, &header);
+
+    #pragma omp for schedule(static)
+    for (int64_t i = 0 ; i < (int64_t)n ; i++)
+    {
+      p.X = XYZ[3*i];
+      p.Y = XYZ[3*i+1];
+      p.Z = XYZ[3*i+2];
+      I32 d = (depth[i] < 0) ? max_depth : depth[i];
+      EPTkey key = octree.get_key(&p, d);
+      keys[i] = ((uint64_t)d << 57) | ((uint64_t)key.x << 38) | ((uint64_t)key.y << 19) | (uint64_t)key.z;
+    }
+  }
+
+  std::vector<int8_t>().swap(depth);
+  radix_sort(keys, sorted);
+
+  octants.clear();
+  for (size_t i = 0 ; i < n ; i++)
+  {
+    if (i == 0 || keys[i] != keys[i-1])
+    {
+      RLASOctant octant;
+      uint64_t key = keys[i];
+      octant.key = EPTkey((I32)(key >> 57), (I32)((key >> 38) & 0x7FFFF), (I32)((key >> 19) & 0x7FFFF), (I32)(key & 0x7FFFF));
+      octant.count = 0;
+      octants.push_back(octant);
+    }
+    octants.back().count++;
+  }
+
+  order.assign(sorted.begin(), sorted.end());
+}
+
+void copc_octree(LASheader& header, const I32* XYZ, size_t n, uint64_t max_points_per_octant, int grid_size, std::vector<size_t>& order, std::vector<RLASOctant>& octants, LASvlr_copc_info& info)
+{
+  I32 min[3] = {I32_MAX, I32_MAX, I32_MAX};
+  I32 max[3] = {I32_MIN, I32_MIN, I32_MIN};
+
+  for (size_t i = 0 ; i < n ; i++)
+  {
+    for (int k = 0 ; k < 3 ; k++)
+    {
+      I32 q = XYZ[3*i+k];
+      if (q < min[k]) min[k] = q;
+      if (q > max[k]) max[k] = q;
+    }
+  }
+
+  // A cube of size 0 (a single point) cannot be divided
+  if (min[0] == max[0] && min[1] == max[1] && min[2] == max[2]) max[0]++;
+
+  header.min_x = header.get_x(min[0]);
+  header.min_y = header.get_y(min[1]);
+  header.min_z = header.get_z(min[2]);
+  header.max_x = header.get_x(max[0]);
+  header.max_y = header.get_y(max[1]);
+  header.max_z = header.get_z(max[2]);
+  header.number_of_point_records = 0;
+  header.extended_number_of_point_records = n;
+
+  EPToctree octree(header);
+  octree.set_gridsize(grid_size);
+  I32 max_depth = EPToctree::compute_max_depth(header, max_points_per_octant);
+
+  // A cell of the sampling grid is identified on 64 bits: 21 bits per axis for the octant and
+  // the cell in the octant
+  int bits = 0;
+  while ((1 << bits) < octree.get_gridsize()) bits++;
+  if (max_depth > 21 - bits) max_depth = 21 - bits;
+
+  if (n <= UINT32_MAX)
+    copc_place<uint32_t>(header, octree, XYZ, n, max_depth, bits, order, octants);
+  else
+    copc_place<uint64_t>(header, octree, XYZ, n, max_depth, bits, order, octants);
+
+  memset(&info, 0, sizeof(LASvlr_copc_info));
+  info.center_x = octree.get_center_x();
+  info.center_y = octree.get_center_y();
+  info.center_z = octree.get_center_z();
+  info.halfsize = octree.get_halfsize();
+  info.spacing = octree.get_size()/octree.get_gridsize();
+}
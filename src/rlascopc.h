@@ -0,0 +1,34 @@
+#ifndef RLASCOPC_H
+#define RLASCOPC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "lascopc.hpp"
+
+// A non empty octant of a COPC file and its number of points
+struct RLASOctant
+{
+  EPTkey key;
+  uint64_t count;
+};
+
+// Order in which the points are written and number of points of each chunk closed with
+// LASwriter::chunk(). The points of a COPC file are written octant by octant, one chunk per octant.
+struct RLASWriteOrder
+{
+  std::vector<size_t> points;
+  std::vector<uint64_t> chunks;
+};
+
+// Builds the octree of a COPC file from the quantized coordinates of the points (XYZXYZ...). A
+// point is placed in the first octant from the root where its cell of the sampling grid
+// (grid_size^3 cells) is still free, or in an octant of maximum depth. The maximum depth is chosen
+// such that the octants hold about max_points_per_octant points. The bounding box and the number of
+// points of the header are updated with the points. 'order' receives the order in which the points
+// are written (octant by octant) and 'octants' the octants in the same order: by depth, then by x,
+// y and z. 'info' receives the cube and the spacing of the octree.
+void copc_octree(LASheader& header, const I32* XYZ, size_t n, uint64_t max_points_per_octant, int grid_size, std::vector<size_t>& order, std::vector<RLASOctant>& octants, LASvlr_copc_info& info);
+
+#endif //RLASCOPC_H
@@ -1,5 +1,7 @@
 #include "rlasextrabytesattributes.h"
 
+#include <string.h>
+
 RLASExtrabyteAttributes::RLASExtrabyteAttributes()
 {
   id = 0;
@@ -129,27 +131,34 @@ I32 RLASExtrabyteAttributes::get_attribute_int(LASpoint* point)
   return casted_value;
 }
 
-void RLASExtrabyteAttributes::set_attribute(int i, LASpoint* p)
+void RLASExtrabyteAttributes::set_attribute_value(double x, LASpoint* p)
+{
+  set_attribute_value(x, p->extra_bytes);
+}
+
+void RLASExtrabyteAttributes::set_attribute_value(double x, U8* extra_bytes)
 {
   double value;
 
-  if (has_no_data && Rcpp::NumericVector::is_na(Reb[i]))
+  if (has_no_data && Rcpp::NumericVector::is_na(x))
     value = no_data;
   else
-    value = (Reb[i] - offset)/scale;
+    value = (x - offset)/scale;
+
+  U8* b = extra_bytes + start;
 
   switch(data_type)
   {
-    case 0: p->set_attribute(start, U8_CLAMP(U8_QUANTIZE(value))); break;
-    case 1: p->set_attribute(start, I8_CLAMP(I8_QUANTIZE(value))); break;
-    case 2: p->set_attribute(start, U16_CLAMP(U16_QUANTIZE(value))); break;
-    case 3: p->set_attribute(start, I16_CLAMP(I16_QUANTIZE(value))); break;
-    case 4: p->set_attribute(start, U32_CLAMP(U32_QUANTIZE(value))); break;
-    case 5: p->set_attribute(start, I32_CLAMP(I32_QUANTIZE(value))); break;
-    case 6: p->set_attribute(start, U64_QUANTIZE(value)); break;
-    case 7: p->set_attribute(start, I64_QUANTIZE(value)); break;
-    case 8: p->set_attribute(start, (float)(value)); break;
-    case 9: p->set_attribute(start, value); break;
+    case 0: { U8  v = quantize<U8>(value);  memcpy(b, &v, sizeof(v)); break; }
+    case 1: { I8  v = quantize<I8>(value);  memcpy(b, &v, sizeof(v)); break; }
+    case 2: { U16 v = quantize<U16>(value); memcpy(b, &v, sizeof(v)); break; }
+    case 3: { I16 v = quantize<I16>(value); memcpy(b, &v, sizeof(v)); break; }
+    case 4: { U32 v = quantize<U32>(value); memcpy(b, &v, sizeof(v)); break; }
+    case 5: { I32 v = quantize<I32>(value); memcpy(b, &v, sizeof(v)); break; }
+    case 6: { U64 v = quantize<U64>(value); memcpy(b, &v, sizeof(v)); break; }
+    case 7: { I64 v = quantize<I64>(value); memcpy(b, &v, sizeof(v)); break; }
+    case 8: { F32 v = quantize<F32>(value); memcpy(b, &v, sizeof(v)); break; }
+    case 9: { F64 v = quantize<F64>(value); memcpy(b, &v, sizeof(v)); break; }
   }
 }
 
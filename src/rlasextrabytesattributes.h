@@ -27,7 +27,6 @@ public:
   std::string desc;
   std::vector<int> eb32;              // Stores data read from file that fits in a R signed int
   std::vector<double> eb64;           // Stores data read from file that fits in a R signed double
-  Rcpp::NumericVector Reb;            // Stores data read from R. Always casted to double before to be witten
 
 public:
   RLASExtrabyteAttributes();
@@ -35,12 +34,27 @@ public:
   bool is_32bits();                   // Test if the data_type fits in a R signed int r a R signed double
   void push_back(LASpoint*);          // Push and extrabytes value either into eb32 or eb64.
   void parse_options();               // Interpret the int as a set of bit according to the specification
-  void set_attribute(int, LASpoint*); // Update a LASpoint by attibuting the ith value of the extrabytes attribute
+  void set_attribute_value(double, LASpoint*); // Update a LASpoint with a value of the extrabytes attribute (NA allowed)
+  void set_attribute_value(double, U8*);  // Same but in the extra bytes of a point record
   LASattribute make_LASattribute();   // Create a LASattribute from RLASExtrabytesAttribute
 
+  // Rounds and clamps a raw value (unscaled) to the type S of the data_type of the attribute
+  template<typename S> static S quantize(double value);
+
 private:
   F64 get_attribute_double(LASpoint*);
   I32 get_attribute_int(LASpoint*);
 };
 
+template<> inline U8  RLASExtrabyteAttributes::quantize<U8>(double x)  { return U8_CLAMP(U8_QUANTIZE(x)); }
+template<> inline I8  RLASExtrabyteAttributes::quantize<I8>(double x)  { return I8_CLAMP(I8_QUANTIZE(x)); }
+template<> inline U16 RLASExtrabyteAttributes::quantize<U16>(double x) { return U16_CLAMP(U16_QUANTIZE(x)); }
+template<> inline I16 RLASExtrabyteAttributes::quantize<I16>(double x) { return I16_CLAMP(I16_QUANTIZE(x)); }
+template<> inline U32 RLASExtrabyteAttributes::quantize<U32>(double x) { return U32_CLAMP(U32_QUANTIZE(x)); }
+template<> inline I32 RLASExtrabyteAttributes::quantize<I32>(double x) { return I32_CLAMP(I32_QUANTIZE(x)); }
+template<> inline U64 RLASExtrabyteAttributes::quantize<U64>(double x) { return U64_QUANTIZE(x); }
+template<> inline I64 RLASExtrabyteAttributes::quantize<I64>(double x) { return I64_QUANTIZE(x); }
+template<> inline F32 RLASExtrabyteAttributes::quantize<F32>(double x) { return (float)(x); }
+template<> inline F64 RLASExtrabyteAttributes::quantize<F64>(double x) { return x; }
+
 #endif //LASEXTRABYTESATTRIBUTES_H
@@ -0,0 +1,142 @@
+#include "rlassort.h"
+
+#include <string.h>
+#include <numeric>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static inline uint64_t spread_bits(uint32_t v)
+{
+  uint64_t x = v;
+  x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+  x = (x | (x << 8))  & 0x00FF00FF00FF00FFULL;
+  x = (x | (x << 4))  & 0x0F0F0F0F0F0F0F0FULL;
+  x = (x | (x << 2))  & 0x3333333333333333ULL;
+  x = (x | (x << 1))  & 0x5555555555555555ULL;
+  return x;
+}
+
+uint64_t morton_key(int32_t X, int32_t Y)
+{
+  uint32_t x = (uint32_t)X ^ 0x80000000u;
+  uint32_t y = (uint32_t)Y ^ 0x80000000u;
+  return spread_bits(x) | (spread_bits(y) << 1);
+}
+
+uint64_t hilbert_key(int32_t X, int32_t Y)
+{
+  // Iterative xy to d conversion on a 2^32 x 2^32 grid
+  uint32_t x = (uint32_t)X ^ 0x80000000u;
+  uint32_t y = (uint32_t)Y ^ 0x80000000u;
+  uint64_t d = 0;
+
+  for (uint32_t s = 0x80000000u ; s > 0 ; s >>= 1)
+  {
+    uint32_t rx = (x & s) > 0;
+    uint32_t ry = (y & s) > 0;
+    d += (uint64_t)s * (uint64_t)s * ((3 * rx) ^ ry);
+
+    if (ry == 0)
+    {
+      if (rx == 1)
+      {
+        x = ~x;
+        y = ~y;
+      }
+
+      uint32_t tmp = x;
+      x = y;
+      y = tmp;
+    }
+  }
+
+  return d;
+}
+
+uint64_t gpstime_key(double t)
+{
+  uint64_t bits;
+  memcpy(&bits, &t, sizeof(double));
+  return (bits & 0x8000000000000000ULL) ? ~bits : bits | 0x8000000000000000ULL;
+}
+
+template<typename Index> void radix_sort(std::vector<uint64_t>& keys, std::vector<Index>& order)
+{
+  int64_t n = keys.size();
+
+  order.resize(n);
+  std::iota(order.begin(), order.end(), 0);
+
+  if (n < 2) return;
+
+  int nthreads = (n < 100000) ? 1 : rlas_threads();
+
+  std::vector<uint64_t> keys_buffer(n);
+  std::vector<Index> order_buffer(n);
+  std::vector<int64_t> histogram(nthreads*256);
+
+  for (int shift = 0 ; shift < 64 ; shift += 8)
+  {
+    bool skip = false;
+
+    #pragma omp parallel num_threads(nthreads)
+    {
+      // OpenMP may give fewer threads than requested: the keys are split between the threads
+      // of the team (at most nthreads histograms)
+      int tid = 0;
+      int team = 1;
+#ifdef _OPENMP
+      tid = omp_get_thread_num();
+      team = omp_get_num_threads();
+#endif
+      int64_t begin = n*tid/team;
+      int64_t end = n*(tid+1)/team;
+      int64_t* h = &histogram[tid*256];
+
+      for (int b = 0 ; b < 256 ; b++) h[b] = 0;
+      for (int64_t i = begin ; i < end ; i++) h[(keys[i] >> shift) & 0xFF]++;
+
+      #pragma omp barrier
+      #pragma omp single
+      {
+        // Offsets ordered by bucket then by thread so the sort is stable. If all the keys
+        // fall in the same bucket this digit is constant and the pass is useless.
+        int64_t offset = 0;
+        for (int b = 0 ; b < 256 ; b++)
+        {
+          int64_t count = 0;
+          for (int t = 0 ; t < team ; t++)
+          {
+            int64_t c = histogram[t*256+b];
+            histogram[t*256+b] = offset;
+            offset += c;
+            count += c;
+          }
+
+          if (count == n) skip = true;
+        }
+      }
+
+      if (!skip)
+      {
+        for (int64_t i = begin ; i < end ; i++)
+        {
+          int64_t pos = h[(keys[i] >> shift) & 0xFF]++;
+          keys_buffer[pos] = keys[i];
+          order_buffer[pos] = order[i];
+        }
+      }
+    }
+
+    if (!skip)
+    {
+      keys.swap(keys_buffer);
+      order.swap(order_buffer);
+    }
+  }
+}
+
+template void radix_sort<uint32_t>(std::vector<uint64_t>&, std::vector<uint32_t>&);
+template void radix_sort<uint64_t>(std::vector<uint64_t>&, std::vector<uint64_t>&);
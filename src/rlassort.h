@@ -0,0 +1,69 @@
+#ifndef RLASSORT_H
+#define RLASSORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <utility>
+
+#include "rlasthreads.h"
+
+// Space filling curve keys computed on quantized coordinates. The signed 32 bits integers
+// are shifted into the unsigned range to preserve their order.
+uint64_t morton_key(int32_t X, int32_t Y);
+uint64_t hilbert_key(int32_t X, int32_t Y);
+
+// Maps a double onto an unsigned integer with the same ordering
+uint64_t gpstime_key(double t);
+
+// Stable parallel LSD radix sort of the keys. 'order' receives the permutation such as
+// keys[order[i]] is the ith smallest key. Keys are sorted in place. The permutation is stored on
+// 32 bits (uint32_t) or on 64 bits (uint64_t) for point clouds of more than 2^32 points.
+template<typename Index> void radix_sort(std::vector<uint64_t>& keys, std::vector<Index>& order);
+
+// Reorders a column with the permutation computed by radix_sort. Columns that do not have
+// the length of the permutation are constant columns stored with a single value and are left
+// untouched. Only one temporary column is allocated at a time.
+template<typename T, typename Index> void apply_permutation(std::vector<T>& x, const std::vector<Index>& order)
+{
+  if (x.size() != order.size()) return;
+
+  std::vector<T> y(x.size());
+
+  #pragma omp parallel for num_threads(rlas_threads()) schedule(static)
+  for (int64_t i = 0 ; i < (int64_t)order.size() ; i++)
+    y[i] = std::move(x[order[i]]);
+
+  x.swap(y);
+}
+
+// Same for a column that interleaves 'stride' values per point (e.g. XYZXYZ...)
+template<typename T, typename Index> void apply_permutation(std::vector<T>& x, const std::vector<Index>& order, size_t stride)
+{
+  if (x.size() != order.size()*stride) return;
+
+  std::vector<T> y(x.size());
+
+  #pragma omp parallel for num_threads(rlas_threads()) schedule(static)
+  for (int64_t i = 0 ; i < (int64_t)order.size() ; i++)
+  {
+    for (size_t j = 0 ; j < stride ; j++)
+      y[i*stride + j] = x[order[i]*stride + j];
+  }
+
+  x.swap(y);
+}
+
+template<typename Index> void apply_permutation(std::vector<bool>& x, const std::vector<Index>& order)
+{
+  // std::vector<bool> is bit packed and cannot be written concurrently
+  if (x.size() != order.size()) return;
+
+  std::vector<bool> y(x.size());
+  for (size_t i = 0 ; i < order.size() ; i++)
+    y[i] = x[order[i]];
+
+  x.swap(y);
+}
+
+#endif //RLASSORT_H
@@ -0,0 +1,140 @@
+#include <Rcpp.h>
+#include "altrep_compact_replication.h"
+#include "rlasthreads.h"
+
+#include <vector>
+
+using namespace Rcpp;
+
+// Whether a column contains NAs and its range without NAs. Same as anyNA(), min(na.rm = TRUE) and
+// max(na.rm = TRUE) but for several columns in a single pass.
+struct RLASColumnRange
+{
+  bool na = false;
+  double min = R_PosInf;
+  double max = R_NegInf;
+
+  template<typename T> inline void scan(const T* x, R_xlen_t n)
+  {
+    for (R_xlen_t i = 0 ; i < n ; i++)
+    {
+      T v = x[i];
+      if (is_na(v)) { na = true; continue; }
+      if (v < min) min = v;
+      if (v > max) max = v;
+    }
+  }
+
+  inline void merge(const RLASColumnRange& other)
+  {
+    na = na || other.na;
+    if (other.min < min) min = other.min;
+    if (other.max > max) max = other.max;
+  }
+
+  static inline bool is_na(int x) { return x == NA_INTEGER; }
+  static inline bool is_na(double x) { return x != x; }
+};
+
+// Ranges of the columns of a list in one pass. The statistics recorded at read time are not used
+// because a column modified by reference keeps them. The range of a compact repetition is its value. Columns with a data pointer are scanned in
+// parallel by chunks of points. ALTREP columns without data pointer are read by region in the main
+// thread because R is not thread safe.
+// [[Rcpp::export]]
+List C_column_ranges(List x)
+{
+  const R_xlen_t chunk = 65536;
+  int ncol = x.size();
+  std::vector<RLASColumnRange> ranges(ncol);
+  std::vector<const void*> ptrs(ncol, nullptr);
+  R_xlen_t n = 0;
+
+  for (int k = 0 ; k < ncol ; k++)
+  {
+    SEXP col = x[k];
+
+    if (TYPEOF(col) != INTSXP && TYPEOF(col) != LGLSXP && TYPEOF(col) != REALSXP)
+    {
+      ranges[k].min = ranges[k].max = NA_REAL;
+      continue;
+    }
+
+    double value;
+    if (Rf_xlength(col) > 0 && compact_repetition_value(col, value))
+    {
+      int v = (int)value;
+      if (TYPEOF(col) == REALSXP)
+        ranges[k].scan(&value, 1);
+      else
+        ranges[k].scan(&v, 1);
+      continue;
+    }
+
+    ptrs[k] = DATAPTR_OR_NULL(col);
+
+    if (ptrs[k] == nullptr)
+    {
+      R_xlen_t len = Rf_xlength(col);
+      if (TYPEOF(col) == REALSXP)
+      {
+        std::vector<double> buffer(chunk);
+        for (R_xlen_t i = 0 ; i < len ; i += chunk)
+          ranges[k].scan(buffer.data(), REAL_GET_REGION(col, i, chunk, buffer.data()));
+      }
+      else
+      {
+        std::vector<int> buffer(chunk);
+        for (R_xlen_t i = 0 ; i < len ; i += chunk)
+        {
+          R_xlen_t m = (TYPEOF(col) == INTSXP) ? INTEGER_GET_REGION(col, i, chunk, buffer.data()) : LOGICAL_GET_REGION(col, i, chunk, buffer.data());
+          ranges[k].scan(buffer.data(), m);
+        }
+      }
+      continue;
+    }
+
+    n = std::max(n, Rf_xlength(col));
+  }
+
+  std::vector<int> types(ncol);
+  std::vector<R_xlen_t> lengths(ncol);
+  for (int k = 0 ; k < ncol ; k++)
+  {
+    types[k] = TYPEOF(x[k]);
+    lengths[k] = Rf_xlength(x[k]);
+  }
+
+  R_xlen_t nchunks = (n + chunk - 1) / chunk;
+
+  #pragma omp parallel num_threads(rlas_threads())
+  {
+    std::vector<RLASColumnRange> local(ncol);
+
+    #pragma omp for schedule(static) nowait
+    for (R_xlen_t c = 0 ; c < nchunks ; c++)
+    {
+      for (int k = 0 ; k < ncol ; k++)
+      {
+        if (ptrs[k] == nullptr) continue;
+        R_xlen_t first = c*chunk;
+        if (first >= lengths[k]) continue;
+        R_xlen_t m = std::min(chunk, lengths[k] - first);
+        if (types[k] == REALSXP)
+          local[k].scan((const double*)ptrs[k] + first, m);
+        else
+          local[k].scan((const int*)ptrs[k] + first, m);
+      }
+    }
+
+    #pragma omp critical
+    {
+      for (int k = 0 ; k < ncol ; k++) ranges[k].merge(local[k]);
+    }
+  }
+
+  List res(ncol);
+  for (int k = 0 ; k < ncol ; k++)
+    res[k] = NumericVector::create(_["na"] = ranges[k].na, _["min"] = ranges[k].min, _["max"] = ranges[k].max);
+
+  return res;
+}
@@ -1,4 +1,11 @@
 #include "rlasstreamer.h"
+#include "rlassort.h"
+#include "rlascolumnar.h"
+#include "altrep_narrow_integer.h"
+#include "altrep_block_compressed.h"
+#include "altrep_vector.h"
+#include "rlasthreads.h"
+#include "laswritepoint.hpp"
 
 RLASstreamer::RLASstreamer(CharacterVector ifiles, CharacterVector ofile, CharacterVector filter)
 {
@@ -90,6 +97,52 @@ void RLASstreamer::setfilter(CharacterVector filter)
   return;
 }
 
+void RLASstreamer::setsort(CharacterVector sort)
+{
+  if (sort.length() != 1)
+    stop("Sort must have a length 1.");
+
+  std::string sortstd = as<std::string>(sort);
+
+  if (sortstd == "")
+    sortkey = SORT_NONE;
+  else if (sortstd == "morton")
+    sortkey = SORT_MORTON;
+  else if (sortstd == "hilbert")
+    sortkey = SORT_HILBERT;
+  else if (sortstd == "gpstime")
+    sortkey = SORT_GPSTIME;
+  else
+    stop("Sort must be one of 'morton', 'hilbert' or 'gpstime'.");
+
+  if (!inR && sortkey != SORT_NONE)
+    stop("Points can be sorted only when they are read in memory.");
+
+  if (sortkey == SORT_GPSTIME && (format == 0 || format == 2))
+  {
+    Rf_warningcall(R_NilValue, "This point format does not record the gpstime. Points were not sorted.");
+    sortkey = SORT_NONE;
+  }
+
+  return;
+}
+
+void RLASstreamer::setnarrow(bool b)
+{
+  narrow = b;
+}
+
+void RLASstreamer::setcompression(bool b)
+{
+  compress = b;
+}
+
+// Coordinates returned as a 3 x n matrix of doubles or of quantized integers
+void RLASstreamer::setinterleaved(bool quantized)
+{
+  xyzmode = quantized ? XYZ_QUANTIZED : XYZ_INTERLEAVED;
+}
+
 void RLASstreamer::select(CharacterVector string)
 {
   std::string select = as<std::string>(string);
@@ -218,6 +271,7 @@ void RLASstreamer::initialize()
   if (!inR)
   {
     format = lasreader->header.point_data_format;
+    LASwritePoint::set_max_threads(rlas_threads());
     laswriter = laswriteopener.open(&lasreader->header);
 
     if(0 == laswriter || NULL == laswriter)
@@ -230,7 +284,8 @@ void RLASstreamer::initialize()
     format   = get_format(point_type);
     extended = (lasreader->header.version_minor >= 4) && (format >= 6);
 
-    int npoints = lasreader->header.number_of_point_records;
+    I64 npoints = lasreader->npoints;
+    if (npoints < 0) npoints = 0;
 
     bool has_rgb = (format == 2 || format == 3 || format == 5 || format == 7 || format == 8 || format == 10);
     bool has_t   = (format == 1 || format >= 3);
@@ -243,7 +298,7 @@ void RLASstreamer::initialize()
     cha = cha && extended;
 
     if (useFilter)
-      nalloc = ceil((float)npoints/8);
+      nalloc = (npoints + 7)/8;
     else
       nalloc = npoints;
   }
@@ -262,6 +317,9 @@ void RLASstreamer::initialize()
   is_UD_populated = false;
   is_PSI_populated = false;
   point_count = 0;
+  nstored     = 0;
+  xyzmode     = XYZ_COLUMNS;
+  sortkey     = SORT_NONE;
   nsynthetic  = 0;
   nwithheld   = 0;
   initialized = true;
@@ -277,9 +335,16 @@ void RLASstreamer::allocation()
   if(inR)
   {
     // Allocate the required amount of data for mandatory variables
-    X.reserve(nalloc);
-    Y.reserve(nalloc);
-    Z.reserve(nalloc);
+    switch (xyzmode)
+    {
+      case XYZ_COLUMNS:
+        X.reserve(nalloc);
+        Y.reserve(nalloc);
+        Z.reserve(nalloc);
+        break;
+      case XYZ_INTERLEAVED: XYZ.reserve(3*nalloc); break;
+      case XYZ_QUANTIZED: qXYZ.reserve(3*nalloc); break;
+    }
     if(t) T.reserve(nalloc);
     if(i) I.reserve(nalloc);
     if(r) RN.reserve(1);
@@ -372,7 +437,7 @@ void RLASstreamer::allocation()
 bool RLASstreamer::read_point()
 {
   point_count++;
-  progress = (double)lasreader->p_count/(double)lasreader->header.number_of_point_records*100;
+  progress = (double)lasreader->p_count/(double)lasreader->npoints*100;
   return lasreader->read_point();
 }
 
@@ -451,7 +516,7 @@ void RLASstreamer::write_point()
     // vectors will be ALTREPed.
     // At the beginning the guess is that the following attributes are not populated which is very
     // often true for SDF, EoF, Synthetic, Keypoint, Withheld, UD and PSI
-    if (X.size() == 0)
+    if (nstored == 0)
     {
       SDF.push_back(lasreader->point.get_scan_direction_flag());
       EoF.push_back(lasreader->point.get_edge_of_flight_line());
@@ -478,8 +543,8 @@ void RLASstreamer::write_point()
     if (!is_##name##_populated && lasreader->point.lasname() != name[0])  \
     {                                                                     \
       is_##name##_populated = true;                                       \
-      name.reserve(X.capacity());                                         \
-      name.insert(name.end(), X.size()-2, name[0]);                       \
+      name.reserve(capacity());                                           \
+      name.insert(name.end(), nstored-2, name[0]);                        \
     }                                                                     \
                                                                           \
     if (is_##name##_populated)                                            \
@@ -494,17 +559,48 @@ void RLASstreamer::write_point()
     if (!is_##name##_populated && lasreader->point.lasname() != name[0])  \
     {                                                                     \
       is_##name##_populated = true;                                       \
-      name.reserve(X.capacity());                                         \
-      name.insert(name.end(), X.size()-2, (bool) name[0]);                \
+      name.reserve(capacity());                                           \
+      name.insert(name.end(), nstored-2, (bool) name[0]);                 \
     }                                                                     \
                                                                           \
     if (is_##name##_populated)                                            \
       name.push_back(lasreader->point.lasname());                         \
   }
 
-    X.push_back(lasreader->point.get_x());
-    Y.push_back(lasreader->point.get_y());
-    Z.push_back(lasreader->point.get_z());
+    double x = lasreader->point.get_x();
+    double y = lasreader->point.get_y();
+    double z = lasreader->point.get_z();
+
+    switch (xyzmode)
+    {
+      case XYZ_COLUMNS:
+        X.push_back(x);
+        Y.push_back(y);
+        Z.push_back(z);
+        break;
+      case XYZ_INTERLEAVED:
+        XYZ.push_back(x);
+        XYZ.push_back(y);
+        XYZ.push_back(z);
+        break;
+      case XYZ_QUANTIZED:
+        qXYZ.push_back(header->get_X(x));
+        qXYZ.push_back(header->get_Y(y));
+        qXYZ.push_back(header->get_Z(z));
+        break;
+    }
+
+    nstored++;
+
+    // Keys are computed on the coordinates quantized with the scale and offset of the
+    // (merged) header so they do not depend on the file a point comes from.
+    switch (sortkey)
+    {
+      case SORT_MORTON: keys.push_back(morton_key((I32)header->get_X(x), (I32)header->get_Y(y))); break;
+      case SORT_HILBERT: keys.push_back(hilbert_key((I32)header->get_X(x), (I32)header->get_Y(y))); break;
+      case SORT_GPSTIME: keys.push_back(gpstime_key(lasreader->point.get_gps_time())); break;
+      case SORT_NONE: break;
+    }
 
     if (t) T.push_back(lasreader->point.get_gps_time());
     if (i) I.push_back(lasreader->point.get_intensity());
@@ -601,39 +697,38 @@ List RLASstreamer::terminate()
   }
   else
   {
-    lasreader->close();
-    delete lasreader;
+    close();
+    reorder();
 
-    if (laswaveform13reader)
+    // Columns are pushed one by one so a compressed column is released before the next one
+    List lasdata(0);
+    CharacterVector attr_name(0);
+
+    if (xyzmode == XYZ_COLUMNS)
     {
-      laswaveform13reader->close();
-      delete laswaveform13reader;
+      lasdata.push_back(double_column(X, header->x_scale_factor, header->x_offset));
+      lasdata.push_back(double_column(Y, header->y_scale_factor, header->y_offset));
+      lasdata.push_back(double_column(Z, header->z_scale_factor, header->z_offset));
+      X.clear();
+      X.shrink_to_fit();
+      Y.clear();
+      Y.shrink_to_fit();
+      Z.clear();
+      Z.shrink_to_fit();
+
+      attr_name.push_back("X");
+      attr_name.push_back("Y");
+      attr_name.push_back("Z");
+    }
+    else
+    {
+      lasdata.push_back(coordinates_matrix());
+      attr_name.push_back("XYZ");
     }
-
-    lasreader = 0;
-    laswaveform13reader = 0;
-
-    lasreader = 0;
-    laswriter = 0;
-    laswaveform13reader = 0;
-    ended = true;
-
-    List lasdata = List::create(X,Y,Z);
-    X.clear();
-    X.shrink_to_fit();
-    Y.clear();
-    Y.shrink_to_fit();
-    Z.clear();
-    Z.shrink_to_fit();
-
-    CharacterVector attr_name(0);
-    attr_name.push_back("X");
-    attr_name.push_back("Y");
-    attr_name.push_back("Z");
 
     if(t)
     {
-      lasdata.push_back(T);
+      lasdata.push_back(double_column(T, 0, 0));
       attr_name.push_back("gpstime");
       T.clear();
       T.shrink_to_fit();
@@ -641,7 +736,7 @@ List RLASstreamer::terminate()
 
     if(i)
     {
-      lasdata.push_back(I);
+      lasdata.push_back(integer_column(I));
       attr_name.push_back("Intensity");
       I.clear();
       I.shrink_to_fit();
@@ -649,7 +744,7 @@ List RLASstreamer::terminate()
 
     if(r)
     {
-      lasdata.push_back(RN);
+      lasdata.push_back(integer_column(RN));
       attr_name.push_back("ReturnNumber");
       RN.clear();
       RN.shrink_to_fit();
@@ -657,7 +752,7 @@ List RLASstreamer::terminate()
 
     if(n)
     {
-      lasdata.push_back(NoR);
+      lasdata.push_back(integer_column(NoR));
       attr_name.push_back("NumberOfReturns");
       NoR.clear();
       NoR.shrink_to_fit();
@@ -665,7 +760,7 @@ List RLASstreamer::terminate()
 
     if(d)
     {
-      lasdata.push_back(SDF);
+      lasdata.push_back(integer_column(SDF));
       attr_name.push_back("ScanDirectionFlag");
       SDF.clear();
       SDF.shrink_to_fit();
@@ -673,7 +768,7 @@ List RLASstreamer::terminate()
 
     if(e)
     {
-      lasdata.push_back(EoF);
+      lasdata.push_back(integer_column(EoF));
       attr_name.push_back("EdgeOfFlightline");
       EoF.clear();
       EoF.shrink_to_fit();
@@ -681,7 +776,7 @@ List RLASstreamer::terminate()
 
     if(c)
     {
-      lasdata.push_back(C);
+      lasdata.push_back(integer_column(C));
       attr_name.push_back("Classification");
       C.clear();
       C.shrink_to_fit();
@@ -689,7 +784,7 @@ List RLASstreamer::terminate()
 
     if(cha)
     {
-      lasdata.push_back(Channel);
+      lasdata.push_back(integer_column(Channel));
       attr_name.push_back("ScannerChannel");
       Channel.clear();
       Channel.shrink_to_fit();
@@ -747,7 +842,7 @@ List RLASstreamer::terminate()
 
     if(u)
     {
-      lasdata.push_back(UD);
+      lasdata.push_back(integer_column(UD));
       attr_name.push_back("UserData");
       UD.clear();
       UD.shrink_to_fit();
@@ -755,7 +850,7 @@ List RLASstreamer::terminate()
 
     if(p)
     {
-      lasdata.push_back(PSI);
+      lasdata.push_back(integer_column(PSI));
       attr_name.push_back("PointSourceID");
       PSI.clear();
       PSI.shrink_to_fit();
@@ -763,17 +858,17 @@ List RLASstreamer::terminate()
 
     if(rgb)
     {
-      lasdata.push_back(R);
+      lasdata.push_back(integer_column(R));
       attr_name.push_back("R");
       R.clear();
       R.shrink_to_fit();
 
-      lasdata.push_back(G);
+      lasdata.push_back(integer_column(G));
       attr_name.push_back("G");
       G.clear();
       G.shrink_to_fit();
 
-      lasdata.push_back(B);
+      lasdata.push_back(integer_column(B));
       attr_name.push_back("B");
       B.clear();
       B.shrink_to_fit();
@@ -781,7 +876,7 @@ List RLASstreamer::terminate()
 
     if(nir)
     {
-      lasdata.push_back(NIR);
+      lasdata.push_back(integer_column(NIR));
       attr_name.push_back("NIR");
       NIR.clear();
       NIR.shrink_to_fit();
@@ -863,6 +958,315 @@ List RLASstreamer::terminate()
   }
 }
 
+// Attributes stored on 8 or 16 bits are returned as narrow ALTREP integers if requested. Length 1
+// vectors (attributes not populated) are returned as regular vectors to be compacted in R.
+template<typename V> SEXP RLASstreamer::integer_column(std::vector<V>& x)
+{
+  if (narrow && x.size() > 1)
+    return narrow_integer_make(x);
+
+  return IntegerVector(x.begin(), x.end());
+}
+
+// The interleaved coordinates are moved into a 3 x n matrix without copy. Quantized coordinates
+// carry the scale and the offset of the header.
+SEXP RLASstreamer::coordinates_matrix()
+{
+  // R matrices have integer dimensions
+  if (nstored > (U64)INT_MAX)
+    stop("Too many points to return the coordinates in a matrix.");
+
+  SEXP xyz;
+
+  if (xyzmode == XYZ_QUANTIZED)
+  {
+    xyz = PROTECT(std_vector_make(qXYZ));
+    NumericVector scale = NumericVector::create(header->x_scale_factor, header->y_scale_factor, header->z_scale_factor);
+    NumericVector offset = NumericVector::create(header->x_offset, header->y_offset, header->z_offset);
+    Rf_setAttrib(xyz, Rf_install("scale"), scale);
+    Rf_setAttrib(xyz, Rf_install("offset"), offset);
+  }
+  else
+  {
+    xyz = PROTECT(std_vector_make(XYZ));
+  }
+
+  IntegerVector dim = IntegerVector::create(3, (int)nstored);
+  Rf_setAttrib(xyz, R_DimSymbol, dim);
+  Rf_setAttrib(xyz, R_DimNamesSymbol, List::create(CharacterVector::create("X", "Y", "Z"), R_NilValue));
+
+  UNPROTECT(1);
+  return xyz;
+}
+
+// Capacity of the vectors of coordinates in number of points
+size_t RLASstreamer::capacity() const
+{
+  switch (xyzmode)
+  {
+    case XYZ_INTERLEAVED: return XYZ.capacity()/3;
+    case XYZ_QUANTIZED: return qXYZ.capacity()/3;
+    default: return X.capacity();
+  }
+}
+
+// Coordinates and gpstime are returned as block compressed ALTREP vectors if requested. Coordinates
+// are compressed on their quantized values (scale != 0).
+SEXP RLASstreamer::double_column(std::vector<double>& x, double scale, double offset)
+{
+  if (compress && x.size() > 1)
+    return block_compressed_make(x, scale, offset);
+
+  return wrap(x);
+}
+
+void RLASstreamer::terminate(ArrowSchema* schema, ArrowArray* array)
+{
+  if (!inR)
+    stop("Internal error: Arrow export is only available when reading in memory."); // # nocov
+
+  close();
+  reorder();
+
+  RLASArrowExporter exporter(nstored);
+  export_columns(exporter);
+  exporter.finalize(schema, array);
+}
+
+void RLASstreamer::terminate(const std::string& file, const std::string& key)
+{
+  if (!inR)
+    stop("Internal error: columnar export is only available when reading in memory."); // # nocov
+
+  close();
+  reorder();
+
+  try
+  {
+    RLASColumnarWriter writer(file, key, nstored);
+    export_columns(writer);
+    writer.close();
+  }
+  catch (std::exception& e)
+  {
+    stop(e.what());
+  }
+}
+
+// Hands the columns to an exporter (Arrow, columnar file) with the same names and the same order
+// than terminate(). The exporter takes the ownership of the memory of the vectors.
+template<typename Exporter> void RLASstreamer::export_columns(Exporter& exporter)
+{
+  exporter.add("X", X);
+  exporter.add("Y", Y);
+  exporter.add("Z", Z);
+  if (t) exporter.add("gpstime", T);
+  if (i) exporter.add("Intensity", I);
+  if (r) exporter.add("ReturnNumber", RN);
+  if (n) exporter.add("NumberOfReturns", NoR);
+  if (d) exporter.add("ScanDirectionFlag", SDF);
+  if (e) exporter.add("EdgeOfFlightline", EoF);
+  if (c) exporter.add("Classification", C);
+  if (cha) exporter.add("ScannerChannel", Channel);
+  if (s) exporter.add("Synthetic_flag", Synthetic);
+  if (k) exporter.add("Keypoint_flag", Keypoint);
+  if (w) exporter.add("Withheld_flag", Withheld);
+  if (o) exporter.add("Overlap_flag", Overlap);
+  if (a && extended) exporter.add("ScanAngle", SA);
+  if (a && !extended) exporter.add("ScanAngleRank", SAR);
+  if (u) exporter.add("UserData", UD);
+  if (p) exporter.add("PointSourceID", PSI);
+
+  if (rgb)
+  {
+    exporter.add("R", R);
+    exporter.add("G", G);
+    exporter.add("B", B);
+  }
+
+  if (nir) exporter.add("NIR", NIR);
+
+  if (W)
+  {
+    exporter.add("WDPIndex", wavePacketIndex);
+    exporter.add("WDPOffset", wavePacketOffset);
+    exporter.add("WDPSize", wavePacketSize);
+    exporter.add("WDPLocation", wavePacketLocation);
+    exporter.add("Xt", Xt);
+    exporter.add("Yt", Yt);
+    exporter.add("Zt", Zt);
+    Rf_warningcall(R_NilValue, "Full waveform samples are not exported.");
+  }
+
+  for(auto& ExtraByte : extra_bytes_attr)
+  {
+    if (ExtraByte.is_32bits())
+      exporter.add(ExtraByte.name, ExtraByte.eb32, (int)NA_INTEGER);
+    else
+      exporter.add(ExtraByte.name, ExtraByte.eb64, (double)NA_REAL);
+  }
+}
+
+void RLASstreamer::close()
+{
+  lasreader->close();
+  delete lasreader;
+
+  if (laswaveform13reader)
+  {
+    laswaveform13reader->close();
+    delete laswaveform13reader;
+  }
+
+  lasreader = 0;
+  laswriter = 0;
+  laswaveform13reader = 0;
+  ended = true;
+}
+
+List RLASstreamer::memory_estimate(int sample)
+{
+  // Fraction of the points retained by the filter. Estimated on the first points of the files.
+  double selectivity = 1;
+  int64_t nsampled = 0;
+
+  if (useFilter && sample > 0)
+  {
+    int64_t nkept = 0;
+    while (lasreader->p_count < sample && lasreader->read_point()) nkept++;
+    nsampled = lasreader->p_count;
+    if (nsampled > 0) selectivity = (double)nkept/(double)nsampled;
+  }
+
+  // Bytes per point of the vectors of the streamer and of the R vectors returned. Attributes that
+  // may be stored with a single value are counted as populated.
+  double cpp = 0;
+  double rbytes = 0;
+  double moved = 0;
+
+  #define COLUMN(b, cppsize, rsize) if (b) { cpp += cppsize; rbytes += rsize; }
+  COLUMN(true, 3*8, 3*8)
+  COLUMN(t, 8, 8)
+
+  // Narrow integers are moved from the streamer to R: they do not add memory at the peak
+  #define NARROW_COLUMN(b, size) if (b) { cpp += size; rbytes += narrow ? size : 4; moved += narrow ? size : 0; }
+  NARROW_COLUMN(i, 2)
+  NARROW_COLUMN(r, 1)
+  NARROW_COLUMN(n, 1)
+  NARROW_COLUMN(d, 1)
+  NARROW_COLUMN(e, 1)
+  NARROW_COLUMN(c, 1)
+  NARROW_COLUMN(cha, 1)
+  NARROW_COLUMN(u, 1)
+  NARROW_COLUMN(p, 2)
+  NARROW_COLUMN(rgb, 3*2)
+  NARROW_COLUMN(nir, 2)
+  #undef NARROW_COLUMN
+
+  COLUMN(s, 0.125, 4)
+  COLUMN(k, 0.125, 4)
+  COLUMN(w, 0.125, 4)
+  COLUMN(o, 0.125, 4)
+  COLUMN(a && extended, 8, 8)
+  COLUMN(a && !extended, 2, 4)
+  COLUMN(W, 4+8+4+4+3*4, 4+8+8+8+3*8)
+  #undef COLUMN
+
+  for (int index : eb)
+  {
+    RLASExtrabyteAttributes extrabyte;
+    extrabyte.data_type = header->attributes[index].data_type;
+    extrabyte.has_scale = header->attributes[index].has_scale();
+    extrabyte.has_offset = header->attributes[index].has_offset();
+    if (!extrabyte.is_supported()) continue;
+    cpp += extrabyte.is_32bits() ? 4 : 8;
+    rbytes += extrabyte.is_32bits() ? 4 : 8;
+  }
+
+  // With a filter the vectors grow dynamically and their capacity can be twice their size
+  double growth = useFilter ? 2 : 1;
+  double npoints = (double)lasreader->npoints;
+  double nread = std::ceil(npoints*selectivity);
+  double peak = cpp*growth + rbytes - moved;
+
+  // Sorting adds the keys (8 bytes) that grow with the columns, the permutation, the copies of the
+  // keys and of the permutation in radix_sort() and the column (8 bytes at most) allocated by
+  // apply_permutation(). They are all counted at the peak.
+  if (sortkey != SORT_NONE)
+  {
+    double index = (nread <= UINT32_MAX) ? 4 : 8;
+    peak += 8*growth + index + (8 + index) + 8;
+  }
+
+  return List::create(_["npoints"] = npoints,
+                      _["selectivity"] = selectivity,
+                      _["sampled"] = (double)nsampled,
+                      _["points"] = nread,
+                      _["size"] = nread*rbytes,
+                      _["peak"] = nread*peak);
+}
+
+void RLASstreamer::reorder()
+{
+  if (keys.empty()) return;
+
+  // The permutation is stored on 32 bits unless the point cloud is larger
+  if (keys.size() <= UINT32_MAX)
+    permute<uint32_t>();
+  else
+    permute<uint64_t>();
+}
+
+template<typename Index> void RLASstreamer::permute()
+{
+  // The permutation is applied column by column so the memory overhead is bounded by the
+  // size of the largest column and not by the size of the point cloud.
+  std::vector<Index> order;
+  radix_sort(keys, order);
+  keys.clear();
+  keys.shrink_to_fit();
+
+  apply_permutation(X, order);
+  apply_permutation(Y, order);
+  apply_permutation(Z, order);
+  apply_permutation(XYZ, order, 3);
+  apply_permutation(qXYZ, order, 3);
+  apply_permutation(T, order);
+  apply_permutation(I, order);
+  apply_permutation(RN, order);
+  apply_permutation(NoR, order);
+  apply_permutation(SDF, order);
+  apply_permutation(EoF, order);
+  apply_permutation(C, order);
+  apply_permutation(Channel, order);
+  apply_permutation(Synthetic, order);
+  apply_permutation(Keypoint, order);
+  apply_permutation(Withheld, order);
+  apply_permutation(Overlap, order);
+  apply_permutation(SA, order);
+  apply_permutation(SAR, order);
+  apply_permutation(UD, order);
+  apply_permutation(PSI, order);
+  apply_permutation(R, order);
+  apply_permutation(G, order);
+  apply_permutation(B, order);
+  apply_permutation(NIR, order);
+  apply_permutation(wavePacketIndex, order);
+  apply_permutation(wavePacketOffset, order);
+  apply_permutation(wavePacketSize, order);
+  apply_permutation(wavePacketLocation, order);
+  apply_permutation(Xt, order);
+  apply_permutation(Yt, order);
+  apply_permutation(Zt, order);
+  apply_permutation(fullwaveform, order);
+
+  for (auto& extra_byte : extra_bytes_attr)
+  {
+    apply_permutation(extra_byte.eb32, order);
+    apply_permutation(extra_byte.eb64, order);
+  }
+}
+
 void RLASstreamer::initialize_bool()
 {
   t = true;
@@ -885,6 +1289,8 @@ void RLASstreamer::initialize_bool()
   W = true;
 
   inR = true;
+  narrow = false;
+  compress = false;
   useFilter = false;
   initialized = false;
   ended = false;
@@ -7,6 +7,7 @@
 #include "lasfilter.hpp"
 #include "laswaveform13reader.hpp"
 #include "rlasextrabytesattributes.h"
+#include "rlasarrow.h"
 
 using namespace Rcpp;
 
@@ -18,12 +19,19 @@ class RLASstreamer
     void setinputfiles(CharacterVector);
     void setoutputfile(CharacterVector);
     void setfilter(CharacterVector);
+    void setsort(CharacterVector);
+    void setnarrow(bool);
+    void setcompression(bool);
+    void setinterleaved(bool);
     void select(CharacterVector);
     void allocation();
     bool read_point();
     void write_point();
     LASpoint* point();
     List terminate();
+    void terminate(ArrowSchema*, ArrowArray*);
+    void terminate(const std::string&, const std::string&);
+    List memory_estimate(int);
     void read_t(bool);
     void read_i(bool);
     void read_r(bool);
@@ -49,6 +57,14 @@ class RLASstreamer
   private:
     void initialize_bool();
     void initialize();
+    void close();
+    void reorder();
+    template<typename Index> void permute();
+    template<typename Exporter> void export_columns(Exporter&);
+    template<typename V> SEXP integer_column(std::vector<V>&);
+    SEXP double_column(std::vector<double>&, double, double);
+    SEXP coordinates_matrix();
+    size_t capacity() const;
     int get_format(U8);
     void write_waveform();
 
@@ -56,21 +72,29 @@ class RLASstreamer
     std::vector<double> X;
     std::vector<double> Y;
     std::vector<double> Z;
+
+    // Coordinates stored in a single interleaved vector XYZXYZ... instead of X, Y and Z, either
+    // as doubles or quantized with the scale and offset of the header
+    enum XYZMode {XYZ_COLUMNS, XYZ_INTERLEAVED, XYZ_QUANTIZED};
+    XYZMode xyzmode;
+    std::vector<double> XYZ;
+    std::vector<int> qXYZ;
+
     std::vector<double> T;
     std::vector<unsigned short> I;
-    std::vector<unsigned short> RN;
-    std::vector<unsigned short> NoR;
-    std::vector<unsigned short> SDF;
-    std::vector<unsigned short> EoF;
-    std::vector<unsigned short> C;
-    std::vector<unsigned short> Channel;
+    std::vector<unsigned char> RN;
+    std::vector<unsigned char> NoR;
+    std::vector<unsigned char> SDF;
+    std::vector<unsigned char> EoF;
+    std::vector<unsigned char> C;
+    std::vector<unsigned char> Channel;
     std::vector<bool> Synthetic;
     std::vector<bool> Keypoint;
     std::vector<bool> Withheld;
     std::vector<bool> Overlap;
     std::vector<double> SA;
     std::vector<short> SAR;
-    std::vector<unsigned short> UD;
+    std::vector<unsigned char> UD;
     std::vector<unsigned short> PSI;
     std::vector<unsigned short> R;
     std::vector<unsigned short> G;
@@ -87,6 +111,11 @@ class RLASstreamer
     std::vector< std::vector<int> >fullwaveform;
     std::unordered_set<U64> wavePacketRegistry;
 
+    // Sort keys computed while reading when the points must be reordered
+    enum SortKey {SORT_NONE, SORT_MORTON, SORT_HILBERT, SORT_GPSTIME};
+    SortKey sortkey;
+    std::vector<uint64_t> keys;
+
     LASreadOpener lasreadopener;
     LASwriteOpener laswriteopener;
     LASwaveform13reader* laswaveform13reader;
@@ -95,14 +124,17 @@ class RLASstreamer
     LASheader* header;
 
     int format;
-    int nalloc;
+    I64 nalloc;
 
-    int nsynthetic;
-    int nwithheld;
+    I64 nsynthetic;
+    I64 nwithheld;
 
-    unsigned int point_count;
+    U64 point_count;
+    U64 nstored;
 
     bool inR;
+    bool narrow;
+    bool compress;
     bool useFilter;
     bool initialized;
     bool ended;
@@ -0,0 +1,38 @@
+#ifndef RLASTHREADS_H
+#define RLASTHREADS_H
+
+#ifndef R_NO_REMAP
+#define R_NO_REMAP
+#endif
+#include <Rinternals.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Number of threads of the parallel regions of rlas: options(rlas.threads), 2 by default, at most
+// the number of threads available to OpenMP. Reads an R option so it is called by the main thread
+// before a parallel region, never inside.
+inline int rlas_threads()
+{
+  int n = 2;
+
+  SEXP option = Rf_GetOption1(Rf_install("rlas.threads"));
+  if (option != R_NilValue)
+  {
+    int value = Rf_asInteger(option);
+    if (value != NA_INTEGER) n = value;
+  }
+
+  if (n < 1) n = 1;
+
+#ifdef _OPENMP
+  if (n > omp_get_max_threads()) n = omp_get_max_threads();
+#else
+  n = 1;
+#endif
+
+  return n;
+}
+
+#endif //RLASTHREADS_H
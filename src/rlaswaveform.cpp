@@ -0,0 +1,119 @@
+#include "rlaswaveform.h"
+
+#include <Rcpp.h>
+#include <string.h>
+
+RLASWaveformWriter::RLASWaveformWriter()
+{
+  orphans = 0;
+  writer = 0;
+  descriptors = 0;
+}
+
+RLASWaveformWriter::~RLASWaveformWriter()
+{
+  close();
+}
+
+bool RLASWaveformWriter::open(const char* file_name, const LASheader& header)
+{
+  if (header.vlr_wave_packet_descr == 0)
+    return false;
+
+  descriptors = header.vlr_wave_packet_descr;
+  writer = new LASwaveform13writer();
+
+  if (!writer->open(file_name, header.vlr_wave_packet_descr))
+  {
+    delete writer;
+    writer = 0;
+    return false;
+  }
+
+  return true;
+}
+
+void RLASWaveformWriter::write(U8* wavepacket, int index, double offset, double location, double xt, double yt, double zt, SEXP samples)
+{
+  point.wavepacket.zero();
+
+  if (index <= 0 || index > 255)
+  {
+    memcpy(wavepacket, &point.wavepacket, 29);
+    return;
+  }
+
+  const LASvlr_wave_packet_descr* descr = descriptors[index];
+  if (descr == 0)
+    Rcpp::stop("No wave packet descriptor in the header for the waveform index %d.", index);
+
+  point.wavepacket.setIndex((U8)index);
+  point.wavepacket.setLocation((F32)location);
+  point.wavepacket.setXt((F32)xt);
+  point.wavepacket.setYt((F32)yt);
+  point.wavepacket.setZt((F32)zt);
+
+  if (TYPEOF(samples) != INTSXP)
+    Rcpp::stop("The waveforms of the points must be integer vectors.");
+
+  U32 nsamples = descr->getNumberOfSamples();
+  U32 nbytes = descr->getBitsPerSample()/8;
+  R_xlen_t n = Rf_xlength(samples);
+  const int* s = INTEGER(samples);
+  uint64_t key = (uint64_t)offset;
+
+  if (n != (R_xlen_t)nsamples)
+  {
+    if (n != 1 || s[0] != 0)
+      Rcpp::stop("The waveform of a point has %d samples. The wave packet descriptor %d expects %d samples.", (int)n, index, (int)nsamples);
+
+    // A return that shares the packet of another return
+    auto it = written.find(key);
+    if (it == written.end())
+    {
+      orphans++;
+      point.wavepacket.zero();
+    }
+    else
+    {
+      point.wavepacket.setOffset(it->second.first);
+      point.wavepacket.setSize(it->second.second);
+    }
+
+    memcpy(wavepacket, &point.wavepacket, 29);
+    return;
+  }
+
+  buffer.resize((size_t)nsamples*nbytes);
+  if (nbytes == 1)
+    for (U32 i = 0 ; i < nsamples ; i++) buffer[i] = (U8)s[i];
+  else
+    for (U32 i = 0 ; i < nsamples ; i++) ((U16*)buffer.data())[i] = (U16)s[i];
+
+  if (!writer->write_waveform(&point, buffer.data()))
+    Rcpp::stop("LASlib internal error. See message above.");
+
+  auto packet = std::make_pair(point.wavepacket.getOffset(), point.wavepacket.getSize());
+  auto inserted = written.insert(std::make_pair(key, packet));
+  if (!inserted.second)
+    inserted.first->second = packet;
+  else
+  {
+    history.push_back(key);
+    if (history.size() > RLAS_WAVEFORM_WINDOW)
+    {
+      written.erase(history.front());
+      history.pop_front();
+    }
+  }
+
+  memcpy(wavepacket, &point.wavepacket, 29);
+}
+
+void RLASWaveformWriter::close()
+{
+  if (writer == 0) return;
+  writer->close();
+  delete writer;
+  writer = 0;
+}
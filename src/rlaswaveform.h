@@ -0,0 +1,51 @@
+#ifndef RLASWAVEFORM_H
+#define RLASWAVEFORM_H
+
+#include <Rinternals.h>
+#include <stdint.h>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "lasdefinitions.hpp"
+#include "laspoint.hpp"
+#include "laswaveform13writer.hpp"
+
+// Writes the waveform packets of the points of formats 4, 5, 9 and 10 in the external .wdp or .wdz
+// file of a las file with LASwaveform13writer. The packets are written as the records are built so
+// the memory stays bounded. read.las() reads a packet shared by several returns once and gives the
+// other returns a single 0 as waveform (see RLASstreamer::write_waveform). Such a packet is written
+// once and the returns that share its original offset point to the packet written. Only the last
+// RLAS_WAVEFORM_WINDOW packets written are remembered: the returns of a pulse are close to each
+// other in the files and in the spatial or temporal orders of write.las().
+#define RLAS_WAVEFORM_WINDOW 65536
+
+class RLASWaveformWriter
+{
+public:
+  RLASWaveformWriter();
+  ~RLASWaveformWriter();
+
+  bool open(const char* file_name, const LASheader& header);
+
+  // Fills the 29 bytes of the wave packet of a record and writes its samples (an integer vector)
+  void write(U8* wavepacket, int index, double offset, double location, double xt, double yt, double zt, SEXP samples);
+
+  void close();
+
+  // Number of returns whose shared packet was not written because the return that held the
+  // samples was not written or was written too long before. They are written without waveform
+  // (descriptor index 0).
+  uint64_t orphans;
+
+private:
+  LASwaveform13writer* writer;
+  const LASvlr_wave_packet_descr* const* descriptors;
+  std::unordered_map<uint64_t, std::pair<uint64_t, uint32_t>> written;
+  std::deque<uint64_t> history;
+  std::vector<U8> buffer;
+  LASpoint point;
+};
+
+#endif //RLASWAVEFORM_H
@@ -1,25 +1,623 @@
 #include <Rcpp.h>
 #include <string.h>
+#include <algorithm>
+#include <memory>
+#include <type_traits>
 
+#include "lasreader.hpp"
 #include "laswriter.hpp"
+#include "laswriter_las.hpp"
+#include "lasindex.hpp"
+#include "lasquadtree.hpp"
+#include "bytestreamin_file.hpp"
+#include "bytestreamout_array.hpp"
+#include "bytestreamout_file.hpp"
+#include "laswritepoint.hpp"
+#include "altrep_compact_replication.h"
 #include "rlasextrabytesattributes.h"
+#include "rlasarrow.h"
+#include "rlascopc.h"
+#include "rlassort.h"
+#include "rlaswaveform.h"
 
 using namespace Rcpp;
 
 int  get_point_data_record_length(int x);
 void set_guid(LASheader&, const char*);
+void* arrow_pointer(SEXP);
+LASquadtree* lax_quadtree(F64, F64, F64, F64);
 void set_global_enconding(LASheader&, List);
+void set_header(LASheader&, List, CharacterVector, std::vector<RLASExtrabyteAttributes>&);
+void write_points(LASwriter*, LASheader&, List, std::vector<RLASExtrabyteAttributes>&, const RLASWriteOrder* = NULL, RLASWaveformWriter* = NULL);
+void write_points(LASwriter*, LASheader&, const ArrowSchema*, const ArrowArray*, std::vector<RLASExtrabyteAttributes>&);
+void read_coordinates(const LASquantizer&, List, std::vector<I32>&);
+bool read_range(SEXP, double&, double&);
+
+static inline bool is_waveform_format(int format) { return format == 4 || format == 5 || format == 9 || format == 10; }
+
+static inline bool msb_less(uint64_t a, uint64_t b) { return a < b && a < (a ^ b); }
+
+// Order in which the points are written when they are sorted (see write.las). The keys are the keys
+// of read.las(sort = ...) so the points of a sorted file are already sorted for read.las. Along a
+// space filling curve two consecutive keys that differ by a higher bit belong to larger distinct
+// cells. The points are cut into chunks of at most chunk_size points, each chunk ending in its second
+// half between the two keys that differ by the highest bit, i.e. at the boundary of the largest cell.
+static bool sort_order(class LASheader& header, List data, std::string sort, U32 chunk_size, RLASWriteOrder& order)
+{
+  if (sort == "") return false;
+
+  if (sort == "gpstime" && (header.point_data_format == 0 || header.point_data_format == 2 || !data.containsElementNamed("gpstime")))
+  {
+    Rf_warningcall(R_NilValue, "This point format does not record the gpstime. Points were not sorted.");
+    return false;
+  }
+
+  // Points with a constant gpstime are already sorted
+  double value;
+  bool gpstime = sort == "gpstime";
+  if (gpstime && compact_repetition_value(data["gpstime"], value))
+    return false;
+
+  // The keys are computed in parallel from the data pointers
+  NumericVector X = (gpstime) ? NumericVector(0) : data["X"];
+  NumericVector Y = (gpstime) ? NumericVector(0) : data["Y"];
+  NumericVector T = (gpstime) ? data["gpstime"] : NumericVector(0);
+  const double* x = X.begin();
+  const double* y = Y.begin();
+  const double* t = T.begin();
+  bool morton = sort == "morton";
+  R_xlen_t n = Rf_xlength(data["X"]);
+
+  std::vector<uint64_t> keys(n);
+  const LASquantizer& q = header;
+
+  #pragma omp parallel for num_threads(rlas_threads()) schedule(static)
+  for (R_xlen_t i = 0 ; i < n ; i++)
+  {
+    if (gpstime)
+      keys[i] = gpstime_key(t[i]);
+    else if (morton)
+      keys[i] = morton_key((I32)q.get_X(x[i]), (I32)q.get_Y(y[i]));
+    else
+      keys[i] = hilbert_key((I32)q.get_X(x[i]), (I32)q.get_Y(y[i]));
+  }
+
+  std::vector<uint64_t> permutation;
+  radix_sort(keys, permutation);
+  order.points.assign(permutation.begin(), permutation.end());
+  order.chunks.clear();
+
+  if (gpstime) return true;
+
+  size_t first = 0;
+  while (first < (size_t)n)
+  {
+    size_t last = std::min((size_t)n, first + chunk_size);
+    size_t end = last;
+
+    if (last < (size_t)n)
+    {
+      uint64_t best = 0;
+      for (size_t i = first + chunk_size/2 ; i < last ; i++)
+      {
+        uint64_t diff = keys[i-1] ^ keys[i];
+        if (!msb_less(diff, best)) { best = diff; end = i; }
+      }
+    }
+
+    order.chunks.push_back(end - first);
+    first = end;
+  }
+
+  return true;
+}
+
+// Writes the lax file of a file that was just written. The points are indexed with their quantized
+// coordinates in the order they were written, so the file is not read and decoded again like in
+// writelax(). The quadtree covers the bounding box of the points written.
+template<typename F>
+static bool write_lax(const char* file, const LASquantizer& q, const LASinventory& inventory, size_t n, F get_XY)
+{
+  if (n == 0) return true;
+
+  LASindex lasindex;
+  lasindex.prepare(lax_quadtree(q.get_x(inventory.min_X), q.get_x(inventory.max_X), q.get_y(inventory.min_Y), q.get_y(inventory.max_Y)), 1000);
+
+  I32 X, Y;
+  for (size_t i = 0 ; i < n ; i++)
+  {
+    get_XY(i, X, Y);
+    lasindex.add(q.get_x(X), q.get_y(Y), (U32)i);
+  }
+
+  lasindex.complete(100000, -20, FALSE);
+  return lasindex.write(file);
+}
 
 // [[Rcpp::export]]
-void C_writer(CharacterVector file, List LASheader, List data)
+void C_writer(CharacterVector file, List LASheader, List data, std::string sort, bool index)
 {
+  class LASheader header;
+  std::vector<RLASExtrabyteAttributes> ExtraBytesAttr;
+  set_header(header, LASheader, data.names(), ExtraBytesAttr);
+
+  LASwriteOpener laswriteopener;
+  laswriteopener.set_file_name(as<std::string>(file).c_str());
+
+  // Sorted points of a laz file are compressed in chunks aligned on the cells of the curve. Chunks of
+  // variable size require the point data formats of LAS 1.4. Other files keep chunks of fixed size.
+  R_xlen_t npoints = Rf_xlength(data["X"]);
+
+  // The lax format stores point indices on 32 bits
+  if (index && npoints > (R_xlen_t)U32_MAX)
+    stop("Cannot index a file of more than 4294967295 points.");
+
+  RLASWriteOrder order;
+  bool sorted = sort_order(header, data, sort, LASZIP_CHUNK_SIZE_DEFAULT, order);
+
+  if (sorted && !order.chunks.empty() && laswriteopener.get_format() == LAS_TOOLS_FORMAT_LAZ && header.point_data_format >= 6)
+    laswriteopener.set_chunk_size(0);
+  else
+    order.chunks.clear();
+
+  LASwritePoint::set_max_threads(rlas_threads());
+  LASwriter* laswriter = laswriteopener.open(&header);
+
+  if(0 == laswriter || NULL == laswriter)
+    stop("LASlib internal error. See message above.");
+
+  RLASWaveformWriter waveform;
+  bool has_waveform = is_waveform_format(header.point_data_format);
+  if (has_waveform && !waveform.open(laswriteopener.get_file_name(), header))
+  {
+    laswriter->close();
+    delete laswriter;
+    stop("Cannot write the waveforms. The header must contain the wave packet descriptors.");
+  }
+
+  write_points(laswriter, header, data, ExtraBytesAttr, (sorted) ? &order : NULL, (has_waveform) ? &waveform : NULL);
+
+  laswriter->update_header(&header, true);
+  laswriter->close();
+  waveform.close();
 
-  int format = (int)LASheader["Point Data Format ID"];
-  if (format == 4 || format == 5 || format == 9 || format == 10)
-    Rcpp::stop("Point format with full waveform are not supported yet");
+  if (waveform.orphans > 0)
+    Rf_warningcall(R_NilValue, "%llu points share the waveform of a point that was not written or written too long before. They were written without waveform.", (unsigned long long)waveform.orphans);
 
+  bool indexed = true;
+  if (index)
+  {
+    NumericVector X = data["X"];
+    NumericVector Y = data["Y"];
+    const double* x = X.begin();
+    const double* y = Y.begin();
+    const size_t* o = (sorted) ? order.points.data() : NULL;
+    const LASquantizer& q = header;
+    indexed = write_lax(laswriteopener.get_file_name(), q, laswriter->inventory, npoints, [&](size_t i, I32& qX, I32& qY)
+    {
+      size_t j = (o) ? o[i] : i;
+      qX = (I32)q.get_X(x[j]);
+      qY = (I32)q.get_Y(y[j]);
+    });
+  }
+
+  delete laswriter;
+
+  if (!indexed)
+    stop("LASlib internal error. See message above.");
+}
+
+// [[Rcpp::export]]
+RawVector C_writer_raw(List LASheader, List data, bool compress)
+{
   class LASheader header;
+  std::vector<RLASExtrabyteAttributes> ExtraBytesAttr;
+  set_header(header, LASheader, data.names(), ExtraBytesAttr);
+
+  if (is_waveform_format(header.point_data_format))
+    stop("Point formats with full waveform write the waveforms in a file and cannot be written in memory.");
+
+  // Preallocate the size of an uncompressed file. This is an upper bound for a
+  // laz file and the exact size of a las file, so the buffer almost never grows.
+  I64 alloc = (I64)header.offset_to_point_data + (I64)Rf_xlength(data["X"])*header.point_data_record_length;
+  if (compress) alloc = alloc/4;
+
+  ByteStreamOutArray* stream;
+  if (IS_LITTLE_ENDIAN())
+    stream = new ByteStreamOutArrayLE(alloc);
+  else
+    stream = new ByteStreamOutArrayBE(alloc);
+
+  std::unique_ptr<ByteStreamOutArray> owner(stream);
+
+  // Same compressor as LASwriteOpener would choose for a .laz file
+  U32 compressor = (compress) ? LASZIP_COMPRESSOR_LAYERED_CHUNKED : LASZIP_COMPRESSOR_NONE;
+
+  LASwritePoint::set_max_threads(rlas_threads());
+  LASwriterLAS laswriter;
+  laswriter.set_delete_stream(FALSE);
+
+  if (!laswriter.open(stream, &header, compressor, 2, LASZIP_CHUNK_SIZE_DEFAULT))
+    stop("LASlib internal error. See message above.");
+
+  write_points(&laswriter, header, data, ExtraBytesAttr);
+
+  laswriter.update_header(&header, true);
+  laswriter.close();
+
+  RawVector raw(stream->getSize());
+  memcpy(raw.begin(), stream->getData(), stream->getSize());
+  return raw;
+}
+
+// [[Rcpp::export]]
+void C_writer_arrow(CharacterVector file, List LASheader, SEXP schema, SEXP array)
+{
+  const ArrowSchema* aschema = (const ArrowSchema*)arrow_pointer(schema);
+  const ArrowArray* aarray = (const ArrowArray*)arrow_pointer(array);
+
+  if (aschema == NULL || aarray == NULL || aschema->release == NULL || aarray->release == NULL)
+    stop("Invalid or released Arrow schema or array.");
+
+  if (strcmp(aschema->format, "+s") != 0)
+    stop("The Arrow array must be a struct array (a record batch).");
+
+  // The children are read without bound checks: they must match the schema and hold the rows
+  if (aarray->n_children != aschema->n_children)
+    stop("The Arrow array has %d columns. Its schema has %d columns.", (int)aarray->n_children, (int)aschema->n_children);
+
+  for (int64_t i = 0 ; i < aarray->n_children ; i++)
+  {
+    const ArrowArray* child = aarray->children[i];
+    if (child == NULL || child->length < aarray->offset + aarray->length)
+      stop("The column %d of the Arrow array has fewer values than the array.", (int)i + 1);
+  }
+
+  // Null values can only be written in the extra bytes attributes (as no data). The other
+  // attributes have no NA.
+  const char* core[] = {"X", "Y", "Z", "Intensity", "ReturnNumber", "NumberOfReturns", "ScanDirectionFlag",
+                        "EdgeOfFlightline", "Classification", "Synthetic_flag", "Keypoint_flag", "Withheld_flag",
+                        "Overlap_flag", "UserData", "PointSourceID", "gpstime", "R", "G", "B", "NIR",
+                        "ScanAngleRank", "ScanAngle", "ScannerChannel"};
+
+  for (const char* name : core)
+  {
+    RLASArrowColumn column;
+    if (arrow_find_column(aschema, aarray, name, column) && column.has_na(aarray->length))
+      stop("The column %s of the Arrow array contains null values.", name);
+  }
+
+  std::vector<std::string> names = arrow_column_names(aschema);
+
+  class LASheader header;
+  std::vector<RLASExtrabyteAttributes> ExtraBytesAttr;
+  set_header(header, LASheader, wrap(names), ExtraBytesAttr);
+
+  if (is_waveform_format(header.point_data_format))
+    stop("Point formats with full waveform are not supported with Arrow.");
+
+  LASwriteOpener laswriteopener;
+  laswriteopener.set_file_name(as<std::string>(file).c_str());
+
+  LASwritePoint::set_max_threads(rlas_threads());
+  LASwriter* laswriter = laswriteopener.open(&header);
+
+  if(0 == laswriter || NULL == laswriter)
+    stop("LASlib internal error. See message above.");
+
+  write_points(laswriter, header, aschema, aarray, ExtraBytesAttr);
+
+  laswriter->update_header(&header, true);
+  laswriter->close();
+  delete laswriter;
+}
+
+// A COPC file is a LAS 1.4 laz file whose points are organized in an octree. Each octant is an
+// independent chunk of points. The first VLR gives the cube of the octree and an EVLR indexes the
+// position of the chunks of the octants (see https://copc.io).
+// [[Rcpp::export]]
+void C_writer_copc(CharacterVector file, List LASheader, List data, double max_points_per_octant)
+{
+  class LASheader header;
+  std::vector<RLASExtrabyteAttributes> ExtraBytesAttr;
+  set_header(header, LASheader, data.names(), ExtraBytesAttr);
+
+  if (header.version_minor < 4 || header.point_data_format < 6 || header.point_data_format > 8)
+    stop("COPC files must be LAS 1.4 files with point data format 6, 7 or 8.");
+
+  if (Rf_xlength(data["X"]) == 0)
+    stop("Cannot write an empty point cloud in a COPC file.");
+
+  // The octree is built on the coordinates as they are written in the file i.e. quantized
+  std::vector<I32> XYZ;
+  read_coordinates(header, data, XYZ);
+
+  RLASWriteOrder order;
+  std::vector<RLASOctant> octants;
+  LASvlr_copc_info info;
+  copc_octree(header, XYZ.data(), XYZ.size()/3, (uint64_t)max_points_per_octant, 128, order.points, octants, info);
+  std::vector<I32>().swap(XYZ);
+
+  for (const RLASOctant& octant : octants)
+    order.chunks.push_back(octant.count);
+
+  if (data.containsElementNamed("gpstime"))
+    read_range(data["gpstime"], info.gpstime_minimum, info.gpstime_maximum);
+
+  // The copc info VLR must be the first VLR. The position of the hierarchy is written at close.
+  U8* payload = new U8[sizeof(LASvlr_copc_info)];
+  memcpy(payload, &info, sizeof(LASvlr_copc_info));
+  header.add_vlr("copc", 1, sizeof(LASvlr_copc_info), payload, FALSE, "copc info");
+  std::rotate(header.vlrs, header.vlrs + header.number_of_variable_length_records - 1, header.vlrs + header.number_of_variable_length_records);
+
+  // The hierarchy has a known size and is filled once the chunks are written
+  I64 hierarchy_size = (I64)octants.size()*sizeof(LASvlr_copc_entry);
+  U8* hierarchy = new U8[hierarchy_size];
+  memset(hierarchy, 0, hierarchy_size);
+  header.add_evlr("copc", 1000, hierarchy_size, hierarchy, FALSE, "EPT hierarchy");
+
+  LASwritePoint::set_max_threads(rlas_threads());
+  LASwriterLAS laswriter;
+  if (!laswriter.open(as<std::string>(file).c_str(), &header, LASZIP_COMPRESSOR_LAYERED_CHUNKED, 2, LASZIP_CHUNK_SIZE_DEFAULT))
+    stop("LASlib internal error. See message above.");
+
+  write_points(&laswriter, header, data, ExtraBytesAttr, &order);
+
+  I64 position;
+  U32 nchunks;
+  const U32* bytes;
+  if (!laswriter.get_chunks(&position, &nchunks, &bytes) || nchunks != octants.size())
+    stop("LASlib internal error. See message above.");
+
+  LASvlr_copc_entry* entries = (LASvlr_copc_entry*)hierarchy;
+  for (U32 i = 0 ; i < nchunks ; i++)
+  {
+    entries[i].key.depth = octants[i].key.d;
+    entries[i].key.x = octants[i].key.x;
+    entries[i].key.y = octants[i].key.y;
+    entries[i].key.z = octants[i].key.z;
+    entries[i].offset = position;
+    entries[i].byte_size = bytes[i];
+    entries[i].point_count = (I32)octants[i].count;
+    position += bytes[i];
+  }
+
+  laswriter.update_header(&header, true);
+  laswriter.close();
+}
+
+// A writer open from R that receives the points chunk by chunk (see open_writer.las). The inventory
+// of the LASwriter accumulates the number of points, the number of points by return and the bounding
+// box across the chunks and the header is fixed at close.
+// When the file is indexed the quantized coordinates of the points are recorded (8 bytes per point)
+// to write the lax file at close, when the bounding box of the quadtree is known.
+// When the points are appended to an existing file, the reader of the file holds the header of the
+// file whose EVLRs are written again after the new points at close.
+struct RLASWriter
+{
+  class LASheader header;
+  std::vector<RLASExtrabyteAttributes> ExtraBytesAttr;
+  LASwriter* laswriter;
+  LASreader* lasreader;
+  std::string file;
+  bool index;
+  bool variable_chunks;
+  std::vector<I32> XY;
+  bool has_waveform;
+  RLASWaveformWriter waveform;
+};
+
+static bool close_writer(RLASWriter* writer)
+{
+  if (writer->laswriter == NULL) return true;
+  writer->laswriter->update_header(&writer->header, true);
+  writer->laswriter->close();
+  writer->waveform.close();
+
+  bool indexed = true;
+  if (writer->index)
+  {
+    const I32* XY = writer->XY.data();
+    indexed = write_lax(writer->file.c_str(), writer->header, writer->laswriter->inventory, writer->XY.size()/2, [&](size_t i, I32& X, I32& Y)
+    {
+      X = XY[2*i];
+      Y = XY[2*i+1];
+    });
+    std::vector<I32>().swap(writer->XY);
+  }
+
+  delete writer->laswriter;
+  writer->laswriter = NULL;
+
+  if (writer->lasreader)
+  {
+    writer->lasreader->close();
+    delete writer->lasreader;
+    writer->lasreader = NULL;
+  }
+
+  return indexed;
+}
+
+// The header describes the points of the file as they are stored: same version, point format,
+// scale factors, offsets and extra bytes attributes
+void check_point_layout(const class LASheader& file, const class LASheader& header)
+{
+  if (file.version_minor != header.version_minor)
+    stop("The header is a LAS 1.%d header. The file is a LAS 1.%d file.", header.version_minor, file.version_minor);
+
+  if (file.point_data_format != header.point_data_format || file.point_data_record_length != header.point_data_record_length)
+    stop("The points of the header are points of format %d (%d bytes). The points of the file are points of format %d (%d bytes).", header.point_data_format, header.point_data_record_length, file.point_data_format, file.point_data_record_length);
+
+  if (file.x_scale_factor != header.x_scale_factor || file.y_scale_factor != header.y_scale_factor || file.z_scale_factor != header.z_scale_factor)
+    stop("The scale factors of the header are not the scale factors of the file.");
+
+  if (file.x_offset != header.x_offset || file.y_offset != header.y_offset || file.z_offset != header.z_offset)
+    stop("The offsets of the header are not the offsets of the file.");
+
+  if (file.number_attributes != header.number_attributes)
+    stop("The extra bytes attributes of the header are not the extra bytes attributes of the file.");
+
+  for (I32 i = 0 ; i < file.number_attributes ; i++)
+  {
+    if (file.attributes[i].data_type != header.attributes[i].data_type || strncmp(file.attributes[i].name, header.attributes[i].name, 32) != 0)
+      stop("The extra bytes attributes of the header are not the extra bytes attributes of the file.");
+  }
+}
+
+// The points written after the points of a file must have the layout of the points of the file
+static void check_append(const class LASheader& file, const class LASheader& header)
+{
+  if (file.vlr_copc_info || file.get_vlr("copc", 1))
+    stop("Cannot append points to a COPC file.");
+
+  if (is_waveform_format(file.point_data_format))
+    stop("Cannot append points to a file of point data format %d.", file.point_data_format);
+
+  check_point_layout(file, header);
+
+  for (U32 i = 0 ; i < file.number_of_extended_variable_length_records ; i++)
+  {
+    if (file.evlrs[i].record_length_after_header > 0 && file.evlrs[i].data == 0)
+      stop("Cannot append points to a file with the EVLR '%s' (%d).", file.evlrs[i].user_id, file.evlrs[i].record_id);
+  }
+}
+
+// The file is closed properly if the writer is garbage collected or R exits before close_writer.las()
+static void writer_finalize(RLASWriter* writer)
+{
+  close_writer(writer);
+  delete writer;
+}
+
+typedef XPtr<RLASWriter, PreserveStorage, writer_finalize, true> RLASWriterXPtr;
+
+// [[Rcpp::export]]
+SEXP C_writer_open(CharacterVector file, List LASheader, CharacterVector columns, bool index, bool append)
+{
+  RLASWriter* writer = new RLASWriter;
+  writer->laswriter = NULL;
+  writer->lasreader = NULL;
+  writer->index = index;
+  writer->variable_chunks = false;
+  writer->has_waveform = false;
+  RLASWriterXPtr xwriter(writer, true);
+
+  set_header(writer->header, LASheader, columns, writer->ExtraBytesAttr);
+
+  if (append)
+  {
+    // Only the end of the file is read and written: the points are not decoded except the points
+    // of the last chunk of a laz file when it is not full (see LASwriterLAS::open_append)
+    writer->file = as<std::string>(file);
+
+    LASreadOpener lasreadopener;
+    lasreadopener.set_file_name(writer->file.c_str());
+    writer->lasreader = lasreadopener.open();
+
+    if (0 == writer->lasreader || NULL == writer->lasreader)
+      stop("LASlib internal error. See message above.");
+
+    const class LASheader& existing = writer->lasreader->header;
+    check_append(existing, writer->header);
+
+    LASwritePoint::set_max_threads(rlas_threads());
+    // The file is left untouched if the points cannot be appended: the writer is not closed
+    LASwriterLAS* laswriter = new LASwriterLAS();
+    if (!laswriter->open_append(writer->file.c_str(), &existing))
+    {
+      delete laswriter;
+      stop("LASlib internal error. See message above.");
+    }
+    writer->laswriter = laswriter;
+
+    writer->variable_chunks = existing.laszip && existing.laszip->compressor != LASZIP_COMPRESSOR_NONE && existing.laszip->chunk_size == U32_MAX;
+    return xwriter;
+  }
+
+  LASwriteOpener laswriteopener;
+  laswriteopener.set_file_name(as<std::string>(file).c_str());
+  writer->file = laswriteopener.get_file_name();
+  LASwritePoint::set_max_threads(rlas_threads());
+  writer->laswriter = laswriteopener.open(&writer->header);
+
+  if(0 == writer->laswriter || NULL == writer->laswriter)
+    stop("LASlib internal error. See message above.");
+
+  writer->has_waveform = is_waveform_format(writer->header.point_data_format);
+  if (writer->has_waveform && !writer->waveform.open(writer->file.c_str(), writer->header))
+    stop("Cannot write the waveforms. The header must contain the wave packet descriptors.");
+
+  return xwriter;
+}
+
+// [[Rcpp::export]]
+void C_writer_write(SEXP xwriter, List data)
+{
+  RLASWriterXPtr writer(xwriter);
+
+  if (writer->laswriter == NULL)
+    stop("The writer is closed.");
+
+  if (writer->index)
+  {
+    NumericVector X = data["X"];
+    NumericVector Y = data["Y"];
+    size_t n = writer->XY.size()/2;
+
+    // The lax format stores point indices on 32 bits
+    if (n + X.length() > (size_t)U32_MAX)
+      stop("Cannot index a file of more than 4294967295 points.");
+
+    writer->XY.resize(2*(n + X.length()));
+    for (R_xlen_t i = 0 ; i < X.length() ; i++)
+    {
+      writer->XY[2*(n+i)] = (I32)writer->header.get_X(X[i]);
+      writer->XY[2*(n+i)+1] = (I32)writer->header.get_Y(Y[i]);
+    }
+  }
 
+  // The chunks of a laz file of variable chunks are closed every LASZIP_CHUNK_SIZE_DEFAULT points
+  RLASWriteOrder order;
+  if (writer->variable_chunks)
+  {
+    uint64_t n = (uint64_t)Rf_xlength(data["X"]);
+    for (uint64_t i = 0 ; i < n ; i += LASZIP_CHUNK_SIZE_DEFAULT)
+      order.chunks.push_back(std::min((uint64_t)LASZIP_CHUNK_SIZE_DEFAULT, n - i));
+  }
+
+  write_points(writer->laswriter, writer->header, data, writer->ExtraBytesAttr, (writer->variable_chunks) ? &order : NULL, (writer->has_waveform) ? &writer->waveform : NULL);
+}
+
+// [[Rcpp::export]]
+void C_writer_close(SEXP xwriter)
+{
+  RLASWriterXPtr writer(xwriter);
+  if (!close_writer(writer.get()))
+    stop("LASlib internal error. See message above.");
+
+  if (writer->waveform.orphans > 0)
+    Rf_warningcall(R_NilValue, "%llu points share the waveform of a point that was not written or written too long before. They were written without waveform.", (unsigned long long)writer->waveform.orphans);
+  writer->waveform.orphans = 0;
+}
+
+void* arrow_pointer(SEXP x)
+{
+  // Arrow tools pass the address of the structs either as external pointers or as
+  // double like the 'arrow' package does.
+  switch(TYPEOF(x))
+  {
+    case EXTPTRSXP: return R_ExternalPtrAddr(x);
+    case REALSXP: return (void*)(uintptr_t)Rf_asReal(x);
+    case STRSXP: return (void*)(uintptr_t)std::stoull(as<std::string>(x));
+    default: stop("Cannot interpret this object as a pointer to an Arrow struct.");
+  }
+
+  return NULL;
+}
+
+void set_header(class LASheader& header, List LASheader, CharacterVector columns, std::vector<RLASExtrabyteAttributes>& ExtraBytesAttr)
+{
   // ===========================
   // Public Header Block
   // ===========================
@@ -41,8 +639,6 @@ void C_writer(CharacterVector file, List LASheader, List data)
   header.y_offset             = (double)LASheader["Y offset"];
   header.z_offset             = (double)LASheader["Z offset"];
 
-  bool extended = (header.version_minor >= 4) && (header.point_data_format >= 6);
-
   // 1.2. These one need special interpretation
 
   header.point_data_record_length = get_point_data_record_length(header.point_data_format);
@@ -54,12 +650,17 @@ void C_writer(CharacterVector file, List LASheader, List data)
 
   set_global_enconding(header, LASheader["Global Encoding"]);
 
+  // The waveform packets are written in an external .wdp or .wdz file (see RLASWaveformWriter)
+  if (is_waveform_format(header.point_data_format))
+  {
+    header.unset_global_encoding_bit(1);
+    header.set_global_encoding_bit(2);
+  }
+
   // ===============================
   // 2. VLRS and EVLRS
   // ===============================
 
-  std::vector<RLASExtrabyteAttributes> ExtraBytesAttr;
-
   for(auto extended : {false, true})
   {
     auto record = (!extended) ? "Variable Length Records" : "Extended Variable Length Records";
@@ -133,7 +734,11 @@ void C_writer(CharacterVector file, List LASheader, List data)
 
             ExtraByte.name = as< std::string >(description["name"]);
 
-            if (!data.containsElementNamed(ExtraByte.name.c_str()))
+            bool found = false;
+            for (int j = 0 ; j < columns.size() ; j++)
+              found = found || (as<std::string>(columns[j]) == ExtraByte.name);
+
+            if (!found)
               stop("Extra Bytes described but not present in data.");
 
             ExtraByte.options = (int)description["options"];
@@ -160,7 +765,6 @@ void C_writer(CharacterVector file, List LASheader, List data)
             LASattribute attribute = ExtraByte.make_LASattribute();
 
             ExtraByte.id  = header.add_attribute(attribute);
-            ExtraByte.Reb = as<NumericVector>(data[ExtraByte.name.c_str()]);
             ExtraBytesAttr.push_back(ExtraByte);
           }
 
@@ -207,151 +811,730 @@ void C_writer(CharacterVector file, List LASheader, List data)
           header.add_vlr("LASF_Spec", 3, (U16)(sizeof(CHAR)*(stext_size+null_terminator)), (U8*)vlr_text_area_desc, FALSE, sdesc.c_str());
         }
       }
+      else if (names[i] == "Full WaveForm Description")
+      {
+        if (vlr.containsElementNamed("Full WaveForm") && vlr.containsElementNamed("record ID"))
+        {
+          List fwf = vlr["Full WaveForm"];
+          int record_id = as<int>(vlr["record ID"]);
+          if (record_id < 100 || record_id > 354) continue;
+
+          U8* payload = new U8[26];
+          LASvlr_wave_packet_descr* descr = (LASvlr_wave_packet_descr*)payload;
+          descr->clean();
+          descr->setBitsPerSample((U8)as<int>(fwf["Bits per sample"]));
+          descr->setCompressionType((U8)as<int>(fwf["Waveform compression type"]));
+          descr->setNumberOfSamples((U32)as<double>(fwf["Number of sample"]));
+          descr->setTemporalSpacing((U32)as<double>(fwf["Temporal Spacing"]));
+          descr->setDigitizerGain(as<double>(fwf["Digitizer Gain"]));
+          descr->setDigitizerOffset(as<double>(fwf["Digitizer Offset"]));
+
+          // The descriptor is owned by the VLR. The header indexes the descriptors by wave packet index.
+          header.add_vlr("LASF_Spec", (U16)record_id, 26, payload, FALSE, "Waveform Packet Descr.");
+
+          if (header.vlr_wave_packet_descr == 0)
+          {
+            header.vlr_wave_packet_descr = new LASvlr_wave_packet_descr*[256];
+            memset(header.vlr_wave_packet_descr, 0, 256*sizeof(LASvlr_wave_packet_descr*));
+          }
+          header.vlr_wave_packet_descr[record_id - 99] = descr;
+        }
+      }
       else
       {
       }
     }
   }
+}
 
-  // ===============================
-  // 3. Write the data into the file
-  // ===============================
+// ===============================
+// 3. Write the data into the file
+// ===============================
 
-  LASwriteOpener laswriteopener;
-  laswriteopener.set_file_name(as<std::string>(file).c_str());
+// Points are written by batches of records built column by column and written at once with
+// LASwriter::write_points(). The position of the fields in a record only depends on whether the
+// point format is legacy (0 to 5) or extended (6 to 10) so the loops are specialized at compile
+// time for each layout. Each loop converts a single column for the whole batch: the presence of
+// a column is tested once per batch and an uncompressed file is written with a single copy per
+// batch.
 
-  LASpoint point;
-  point.init(&header, header.point_data_format, header.point_data_record_length, 0);
+#define RLAS_WRITE_BATCH 50000
 
-  LASwriter* laswriter = laswriteopener.open(&header);
+template<bool EXTENDED> struct RLASRecordLayout;
 
-  if(0 == laswriter || NULL == laswriter)
-    stop("LASlib internal error. See message above.");
+template<> struct RLASRecordLayout<false>
+{
+  enum { RETURNS = 14, RETURN_BITS = 3, DIRECTION = 14, FLAGS = 15, FLAGS_SHIFT = 5, CLASSIFICATION = 15, CLASSIFICATION_MASK = 31, SCAN_ANGLE = 16, USER_DATA = 17, POINT_SOURCE_ID = 18, GPSTIME = 20 };
+};
+
+template<> struct RLASRecordLayout<true>
+{
+  enum { RETURNS = 14, RETURN_BITS = 4, DIRECTION = 15, FLAGS = 15, FLAGS_SHIFT = 0, CLASSIFICATION = 16, CLASSIFICATION_MASK = 255, SCAN_ANGLE = 18, USER_DATA = 17, POINT_SOURCE_ID = 20, GPSTIME = 22 };
+};
+
+static inline R_xlen_t get_region(SEXP x, R_xlen_t i, R_xlen_t n, double* buf) { return REAL_GET_REGION(x, i, n, buf); }
+static inline R_xlen_t get_region(SEXP x, R_xlen_t i, R_xlen_t n, int* buf) { return (TYPEOF(x) == LGLSXP) ? LOGICAL_GET_REGION(x, i, n, buf) : INTEGER_GET_REGION(x, i, n, buf); }
+static inline double get_elt(SEXP x, R_xlen_t i, double) { return REAL_ELT(x, i); }
+static inline int get_elt(SEXP x, R_xlen_t i, int) { return (TYPEOF(x) == LGLSXP) ? LOGICAL_ELT(x, i) : INTEGER_ELT(x, i); }
+
+// A column of the data. The columns are read without being expanded in memory: a compact repetition
+// (or a column of length 1) is a constant whose value is repeated for each point, an ALTREP column
+// without data pointer (narrow integers, block compression) is read batch by batch by region or
+// element by element when the points follow an order. Other columns are read through their pointer.
+template<typename T>
+struct RLASWriteColumn
+{
+  RObject vec;
+  const T* x;
+  bool constant;
+  T value;
+  std::vector<T> buffer;
+
+  RLASWriteColumn() : x(0), constant(false), value(0) {}
+  RLASWriteColumn(SEXP v)
+  {
+    // A column of another type is coerced like Rcpp did
+    int type = std::is_same<T, double>::value ? REALSXP : ((TYPEOF(v) == LGLSXP) ? LGLSXP : INTSXP);
+    vec = (TYPEOF(v) == type) ? v : Rf_coerceVector(v, type);
+    x = (const T*)DATAPTR_OR_NULL(vec);
+    constant = false;
+    value = 0;
+
+    double rep;
+    if (Rf_xlength(vec) == 1)
+    {
+      constant = true;
+      value = get_elt(vec, 0, value);
+    }
+    else if (x == 0 && compact_repetition_value(vec, rep))
+    {
+      constant = true;
+      value = (T)rep;
+    }
+  }
+
+  bool present() const { return (SEXP)vec != R_NilValue; }
+
+  T at(R_xlen_t i) const
+  {
+    if (constant) return value;
+    return (x) ? x[i] : get_elt(vec, i, value);
+  }
+
+  // The values of a batch of a column without data pointer
+  const T* read(R_xlen_t first, const size_t* order, U32 n)
+  {
+    buffer.resize(n);
+    if (order)
+      for (U32 j = 0 ; j < n ; j++) buffer[j] = get_elt(vec, (R_xlen_t)order[first + j], value);
+    else
+      get_region(vec, first, n, buffer.data());
+    return buffer.data();
+  }
+};
+
+// Calls f(i, value) for each value of a column, batch by batch
+template<typename F>
+static void read_column(RLASWriteColumn<double>& col, R_xlen_t n, F f)
+{
+  for (R_xlen_t first = 0 ; first < n ; first += RLAS_WRITE_BATCH)
+  {
+    U32 m = (U32)std::min((R_xlen_t)RLAS_WRITE_BATCH, n - first);
+    if (col.x == 0 && !col.constant)
+    {
+      const double* x = col.read(first, NULL, m);
+      for (U32 j = 0 ; j < m ; j++) f(first + j, x[j]);
+    }
+    else
+    {
+      for (U32 j = 0 ; j < m ; j++) f(first + j, col.at(first + j));
+    }
+  }
+}
+
+// The quantized coordinates of the points (XYZXYZ...)
+void read_coordinates(const LASquantizer& q, List data, std::vector<I32>& XYZ)
+{
+  RLASWriteColumn<double> X(data["X"]);
+  RLASWriteColumn<double> Y(data["Y"]);
+  RLASWriteColumn<double> Z(data["Z"]);
+  R_xlen_t n = Rf_xlength(X.vec);
+
+  XYZ.resize(3*(size_t)n);
+  read_column(X, n, [&](R_xlen_t i, double x) { XYZ[3*i] = (I32)q.get_X(x); });
+  read_column(Y, n, [&](R_xlen_t i, double y) { XYZ[3*i+1] = (I32)q.get_Y(y); });
+  read_column(Z, n, [&](R_xlen_t i, double z) { XYZ[3*i+2] = (I32)q.get_Z(z); });
+}
+
+// The range of a column. false if the column is empty.
+bool read_range(SEXP x, double& min, double& max)
+{
+  RLASWriteColumn<double> col(x);
+  R_xlen_t n = Rf_xlength(col.vec);
+  if (n == 0) return false;
+
+  min = max = col.at(0);
+  read_column(col, n, [&](R_xlen_t, double v)
+  {
+    if (v < min) min = v;
+    if (v > max) max = v;
+  });
+  return true;
+}
+
+// Position of the points of a batch in the columns. The points are contiguous or follow an order
+// (see RLASWriteOrder).
+struct RLASPointIndex
+{
+  R_xlen_t first;
+  const size_t* order;
+};
+
+template<typename T, typename F>
+static inline void fill_column(U8* records, U32 size, U32 n, RLASWriteColumn<T>& col, const RLASPointIndex& idx, F set)
+{
+  if (col.constant)
+  {
+    T x = col.value;
+    for (U32 j = 0 ; j < n ; j++) set(records + (size_t)j*size, x);
+  }
+  else if (col.x == 0)
+  {
+    const T* x = col.read(idx.first, idx.order, n);
+    for (U32 j = 0 ; j < n ; j++) set(records + (size_t)j*size, x[j]);
+  }
+  else if (idx.order)
+  {
+    const size_t* o = idx.order + idx.first;
+    for (U32 j = 0 ; j < n ; j++) set(records + (size_t)j*size, col.x[o[j]]);
+  }
+  else
+  {
+    const T* x = col.x + idx.first;
+    for (U32 j = 0 ; j < n ; j++) set(records + (size_t)j*size, x[j]);
+  }
+}
+
+template<typename V>
+static inline void put(U8* b, V v) { memcpy(b, &v, sizeof(V)); }
+
+static inline bool is_na(int x) { return x == NA_INTEGER; }
+static inline bool is_na(double x) { return x != x; }
+
+// An extra bytes attribute column keeps its R type: integer and logical columns are not converted to
+// double before being written.
+struct RLASExtraBytesColumn
+{
+  RLASWriteColumn<int> i;
+  RLASWriteColumn<double> d;
+
+  RLASExtraBytesColumn(SEXP v)
+  {
+    if (TYPEOF(v) == INTSXP || TYPEOF(v) == LGLSXP)
+      i = RLASWriteColumn<int>(v);
+    else
+      d = RLASWriteColumn<double>(v);
+  }
+};
+
+// Encodes the values of an attribute in the extra bytes of the records with the type S of the
+// attribute. The value of the NAs and the scale and offset are resolved once for the batch.
+template<typename S, typename T>
+static void encode_extra_bytes(U8* records, U32 size, U32 n, RLASWriteColumn<T>& col, const RLASPointIndex& idx, const RLASExtrabyteAttributes& attr)
+{
+  double scale = attr.scale;
+  double offset = attr.offset;
+  S na = RLASExtrabyteAttributes::quantize<S>((attr.has_no_data) ? attr.no_data : (NA_REAL - offset)/scale);
+  U8* b = records + attr.start;
+
+  if (attr.has_scale || attr.has_offset)
+  {
+    fill_column(b, size, n, col, idx, [&](U8* r, T x)
+    {
+      S v = is_na(x) ? na : RLASExtrabyteAttributes::quantize<S>((x - offset)/scale);
+      memcpy(r, &v, sizeof(S));
+    });
+  }
+  else
+  {
+    fill_column(b, size, n, col, idx, [&](U8* r, T x)
+    {
+      S v = is_na(x) ? na : RLASExtrabyteAttributes::quantize<S>((double)x);
+      memcpy(r, &v, sizeof(S));
+    });
+  }
+}
+
+template<typename T>
+static void fill_extra_bytes(U8* records, U32 size, U32 n, RLASWriteColumn<T>& col, const RLASPointIndex& idx, const RLASExtrabyteAttributes& attr)
+{
+  switch(attr.data_type)
+  {
+    case 0: encode_extra_bytes<U8>(records, size, n, col, idx, attr); break;
+    case 1: encode_extra_bytes<I8>(records, size, n, col, idx, attr); break;
+    case 2: encode_extra_bytes<U16>(records, size, n, col, idx, attr); break;
+    case 3: encode_extra_bytes<I16>(records, size, n, col, idx, attr); break;
+    case 4: encode_extra_bytes<U32>(records, size, n, col, idx, attr); break;
+    case 5: encode_extra_bytes<I32>(records, size, n, col, idx, attr); break;
+    case 6: encode_extra_bytes<U64>(records, size, n, col, idx, attr); break;
+    case 7: encode_extra_bytes<I64>(records, size, n, col, idx, attr); break;
+    case 8: encode_extra_bytes<F32>(records, size, n, col, idx, attr); break;
+    case 9: encode_extra_bytes<F64>(records, size, n, col, idx, attr); break;
+  }
+}
+
+
+template<bool EXTENDED>
+static void write_records(LASwriter* laswriter, class LASheader& header, List data, std::vector<RLASExtrabyteAttributes>& ExtraBytesAttr, const RLASWriteOrder* order, RLASWaveformWriter* waveform)
+{
+  typedef RLASRecordLayout<EXTENDED> L;
+
+  int format = header.point_data_format;
+  bool has_gpstime = format != 0 && format != 2;
+  bool has_rgb = format == 2 || format == 3 || format == 5 || format == 7 || format == 8 || format == 10;
+  bool has_nir = format == 8 || format == 10;
+  bool has_wave = waveform && (format == 4 || format == 5 || format == 9 || format == 10);
+  int rgb = (EXTENDED) ? 30 : ((format == 2) ? 20 : 28);
+  int eb = get_point_data_record_length(format);
+  int wave = eb - 29;
 
   #define ISSET(NAME) data.containsElementNamed(NAME)
 
-  bool i = ISSET("Intensity");
-  bool r = ISSET("ReturnNumber");
-  bool n = ISSET("NumberOfReturns");
-  bool d = ISSET("ScanDirectionFlag");
-  bool e = ISSET("EdgeOfFlightline");
-  bool c = ISSET("Classification");
-  bool s = ISSET("Synthetic_flag");
-  bool k = ISSET("Keypoint_flag");
-  bool w = ISSET("Withheld_flag");
-  bool o = ISSET("Overlap_flag") && extended;
-  bool u = ISSET("UserData");
-  bool p = ISSET("PointSourceID");
-  bool t = ISSET("gpstime");
-  bool R = ISSET("R");
-  bool G = ISSET("G");
-  bool B = ISSET("B");
-  bool N = ISSET("NIR");
-  bool sar = ISSET("ScanAngleRank");
-  bool esa = ISSET("ScanAngle");
-  bool cha = ISSET("ScannerChannel") && extended;
-
-  NumericVector X   = data["X"];
-  NumericVector Y   = data["Y"];
-  NumericVector Z   = data["Z"];
-  IntegerVector I   = (i) ? data["Intensity"] : IntegerVector(0);
-  IntegerVector RN  = (r) ? data["ReturnNumber"] : IntegerVector(0);
-  IntegerVector NR  = (n) ? data["NumberOfReturns"] : IntegerVector(0);
-  IntegerVector D   = (d) ? data["ScanDirectionFlag"] : IntegerVector(0);
-  IntegerVector E   = (e) ? data["EdgeOfFlightline"] : IntegerVector(0);
-  IntegerVector C   = (c) ? data["Classification"] : IntegerVector(0);
-  LogicalVector S   = (s) ? data["Synthetic_flag"] : LogicalVector(0);
-  LogicalVector K   = (k) ? data["Keypoint_flag"] : LogicalVector(0);
-  LogicalVector W   = (w) ? data["Withheld_flag"] : LogicalVector(0);
-  LogicalVector O   = (o) ? data["Overlap_flag"] : LogicalVector(0);
-  IntegerVector U   = (u) ? data["UserData"] : IntegerVector(0);
-  IntegerVector P   = (p) ? data["PointSourceID"] : IntegerVector(0);
-  NumericVector T   = (t) ? data["gpstime"] : NumericVector(0);
-  IntegerVector Red = (R) ? data["R"] : IntegerVector(0);
-  IntegerVector Gre = (G) ? data["G"] : IntegerVector(0);
-  IntegerVector Blu = (B) ? data["B"] : IntegerVector(0);
-  IntegerVector NIR = (N) ? data["NIR"] : IntegerVector(0);
-  IntegerVector SAR = (sar) ? data["ScanAngleRank"] : IntegerVector(0);
-  NumericVector ESA = (esa) ? data["ScanAngle"] : NumericVector(0);
-  IntegerVector CHA = (cha) ? data["ScannerChannel"] : IntegerVector(0);
-
-  // The following attributes can be ALTREPed at R level to be represented as compact
-  // repetition. If they were ALTREPed then we received a single value instead of a vector
-  // of n times the same value. In this case we initialize the LASpoint with the value and we
-  // declare the attribute as missing to avoid looping through undefined indices.
-  if (!extended)
-  {
-    if (RN.size() == 1) { r = false; point.set_return_number((U8)RN[0]); }
-    if (NR.size() == 1) { n = false; point.set_number_of_returns((U8)NR[0]); }
-    if (C.size() == 1)  { c = false; point.set_classification((U8)C[0]); }
-    if (SAR.size() == 1){ sar = false; point.set_scan_angle_rank((U8)SAR[0]); }
+  // Absent columns have no vector
+  #define COLUMN(TYPE, V, NAME, WHEN) RLASWriteColumn<TYPE> c##V = ((WHEN) && ISSET(NAME)) ? RLASWriteColumn<TYPE>((SEXP)data[NAME]) : RLASWriteColumn<TYPE>()
+
+  COLUMN(double, X, "X", true);
+  COLUMN(double, Y, "Y", true);
+  COLUMN(double, Z, "Z", true);
+  COLUMN(int, I, "Intensity", true);
+  COLUMN(int, RN, "ReturnNumber", true);
+  COLUMN(int, NR, "NumberOfReturns", true);
+  COLUMN(int, D, "ScanDirectionFlag", true);
+  COLUMN(int, E, "EdgeOfFlightline", true);
+  COLUMN(int, C, "Classification", true);
+  COLUMN(int, S, "Synthetic_flag", true);
+  COLUMN(int, K, "Keypoint_flag", true);
+  COLUMN(int, W, "Withheld_flag", true);
+  COLUMN(int, O, "Overlap_flag", EXTENDED);
+  COLUMN(int, U, "UserData", true);
+  COLUMN(int, P, "PointSourceID", true);
+  COLUMN(double, T, "gpstime", has_gpstime);
+  COLUMN(int, Red, "R", has_rgb);
+  COLUMN(int, Gre, "G", has_rgb);
+  COLUMN(int, Blu, "B", has_rgb);
+  COLUMN(int, NIR, "NIR", has_nir);
+  COLUMN(int, SAR, "ScanAngleRank", !EXTENDED);
+  COLUMN(double, ESA, "ScanAngle", EXTENDED);
+  COLUMN(int, CHA, "ScannerChannel", EXTENDED);
+  COLUMN(int, WDI, "WDPIndex", has_wave);
+  COLUMN(double, WDO, "WDPOffset", has_wave);
+  COLUMN(double, WDL, "WDPLocation", has_wave);
+  COLUMN(double, Xt, "Xt", has_wave);
+  COLUMN(double, Yt, "Yt", has_wave);
+  COLUMN(double, Zt, "Zt", has_wave);
+  List FWF = (has_wave && ISSET("FWF")) ? data["FWF"] : List(0);
+
+  if (has_wave && (!cWDI.present() || !cWDO.present() || !cWDL.present() || !cXt.present() || !cYt.present() || !cZt.present() || FWF.size() == 0))
+    stop("The point data format records full waveform but the data do not contain the waveform attributes WDPIndex, WDPOffset, WDPLocation, Xt, Yt, Zt and FWF.");
+
+  std::vector<RLASExtraBytesColumn> cEB;
+  for(auto& ExtraByte : ExtraBytesAttr)
+    cEB.emplace_back((SEXP)data[ExtraByte.name.c_str()]);
+
+  U32 size = header.point_data_record_length;
+  R_xlen_t npoints = Rf_xlength(cX.vec);
+  std::vector<U8> buffer((size_t)size*std::min<R_xlen_t>(npoints, RLAS_WRITE_BATCH));
+  U8* records = buffer.data();
+
+  const LASquantizer& q = header;
+
+  // With an order the batches do not span two chunks and a chunk is closed after its last batch
+  size_t chunk = 0;
+  R_xlen_t end = (order && order->chunks.size()) ? (R_xlen_t)order->chunks[0] : npoints;
+  U32 n;
+
+  for (R_xlen_t first = 0 ; first < npoints ; first += n)
+  {
+    n = (U32)std::min<R_xlen_t>(end - first, RLAS_WRITE_BATCH);
+    RLASPointIndex idx = {first, (order) ? order->points.data() : NULL};
+
+    // Bit fields are or-ed into zeroed records
+    memset(records, 0, (size_t)n*size);
+
+    fill_column(records, size, n, cX, idx, [&](U8* r, double x) { put(r, (I32)q.get_X(x)); });
+    fill_column(records, size, n, cY, idx, [&](U8* r, double y) { put(r+4, (I32)q.get_Y(y)); });
+    fill_column(records, size, n, cZ, idx, [&](U8* r, double z) { put(r+8, (I32)q.get_Z(z)); });
+
+    if (cI.present())   fill_column(records, size, n, cI, idx, [](U8* r, int x) { put(r+12, (U16)x); });
+    if (cRN.present())  fill_column(records, size, n, cRN, idx, [](U8* r, int x) { r[L::RETURNS] |= (U8)x & ((1 << L::RETURN_BITS) - 1); });
+    if (cNR.present())  fill_column(records, size, n, cNR, idx, [](U8* r, int x) { r[L::RETURNS] |= ((U8)x & ((1 << L::RETURN_BITS) - 1)) << L::RETURN_BITS; });
+    if (cD.present())   fill_column(records, size, n, cD, idx, [](U8* r, int x) { r[L::DIRECTION] |= ((U8)x & 1) << 6; });
+    if (cE.present())   fill_column(records, size, n, cE, idx, [](U8* r, int x) { r[L::DIRECTION] |= ((U8)x & 1) << 7; });
+    if (cC.present())   fill_column(records, size, n, cC, idx, [](U8* r, int x) { r[L::CLASSIFICATION] |= (U8)x & L::CLASSIFICATION_MASK; });
+    if (cS.present())   fill_column(records, size, n, cS, idx, [](U8* r, int x) { r[L::FLAGS] |= ((U8)x != 0) << L::FLAGS_SHIFT; });
+    if (cK.present())   fill_column(records, size, n, cK, idx, [](U8* r, int x) { r[L::FLAGS] |= ((U8)x != 0) << (L::FLAGS_SHIFT + 1); });
+    if (cW.present())   fill_column(records, size, n, cW, idx, [](U8* r, int x) { r[L::FLAGS] |= ((U8)x != 0) << (L::FLAGS_SHIFT + 2); });
+    if (cO.present())   fill_column(records, size, n, cO, idx, [](U8* r, int x) { r[L::FLAGS] |= ((U8)x & 1) << 3; });
+    if (cCHA.present()) fill_column(records, size, n, cCHA, idx, [](U8* r, int x) { r[L::FLAGS] |= ((U8)x & 3) << 4; });
+    if (cSAR.present()) fill_column(records, size, n, cSAR, idx, [](U8* r, int x) { r[L::SCAN_ANGLE] = (U8)(I8)x; });
+    if (cESA.present()) fill_column(records, size, n, cESA, idx, [](U8* r, double x) { put(r+L::SCAN_ANGLE, (I16)(x/0.006f)); });
+    if (cU.present())   fill_column(records, size, n, cU, idx, [](U8* r, int x) { r[L::USER_DATA] = (U8)x; });
+    if (cP.present())   fill_column(records, size, n, cP, idx, [](U8* r, int x) { put(r+L::POINT_SOURCE_ID, (U16)x); });
+    if (cT.present())   fill_column(records, size, n, cT, idx, [](U8* r, double x) { put(r+L::GPSTIME, (F64)x); });
+    if (cRed.present()) fill_column(records, size, n, cRed, idx, [&](U8* r, int x) { put(r+rgb, (U16)x); });
+    if (cGre.present()) fill_column(records, size, n, cGre, idx, [&](U8* r, int x) { put(r+rgb+2, (U16)x); });
+    if (cBlu.present()) fill_column(records, size, n, cBlu, idx, [&](U8* r, int x) { put(r+rgb+4, (U16)x); });
+    if (cNIR.present()) fill_column(records, size, n, cNIR, idx, [](U8* r, int x) { put(r+36, (U16)x); });
+
+    for (size_t k = 0 ; k < ExtraBytesAttr.size() ; k++)
+    {
+      if (cEB[k].i.present())
+        fill_extra_bytes(records + eb, size, n, cEB[k].i, idx, ExtraBytesAttr[k]);
+      else
+        fill_extra_bytes(records + eb, size, n, cEB[k].d, idx, ExtraBytesAttr[k]);
+    }
+
+    // The waveform packets are written point by point in the order of the records
+    if (has_wave)
+    {
+      for (U32 j = 0 ; j < n ; j++)
+      {
+        R_xlen_t i = (idx.order) ? (R_xlen_t)idx.order[first + j] : first + j;
+        waveform->write(records + (size_t)j*size + wave, cWDI.at(i), cWDO.at(i), cWDL.at(i), cXt.at(i), cYt.at(i), cZt.at(i), FWF[i]);
+      }
+    }
+
+    if (!laswriter->write_points(records, n))
+      stop("LASlib internal error. See message above.");
+
+    laswriter->inventory.add(records, n, size, EXTENDED);
+
+    if (order && !order->chunks.empty() && first + n == end)
+    {
+      if (!laswriter->chunk())
+        stop("LASlib internal error. See message above.");
+
+      if (++chunk < order->chunks.size())
+        end += (R_xlen_t)order->chunks[chunk];
+    }
+  }
+}
+
+// The attributes of the points that are rewritten in place in the records of a file. The
+// coordinates and the extra bytes are not.
+static bool is_patchable(const std::string& name, int format)
+{
+  bool extended = format >= 6;
+  bool has_gpstime = format != 0 && format != 2;
+  bool has_rgb = format == 2 || format == 3 || format == 5 || format == 7 || format == 8 || format == 10;
+  bool has_nir = format == 8 || format == 10;
+
+  if (name == "Intensity" || name == "ReturnNumber" || name == "NumberOfReturns" || name == "ScanDirectionFlag" ||
+      name == "EdgeOfFlightline" || name == "Classification" || name == "Synthetic_flag" || name == "Keypoint_flag" ||
+      name == "Withheld_flag" || name == "UserData" || name == "PointSourceID")
+    return true;
+
+  if (name == "Overlap_flag" || name == "ScannerChannel" || name == "ScanAngle") return extended;
+  if (name == "ScanAngleRank") return !extended;
+  if (name == "gpstime") return has_gpstime;
+  if (name == "R" || name == "G" || name == "B") return has_rgb;
+  if (name == "NIR") return has_nir;
+  return false;
+}
+
+// Same as write_records() but the records are read from the file batch by batch and only the bits
+// of the columns given are modified before the batch is written back at the same place. 'done' is
+// the number of records written back so far.
+template<bool EXTENDED>
+static void patch_records(ByteStreamIn* in, ByteStreamOut* out, I64 offset, int format, U32 size, R_xlen_t npoints, List data, LASinventory& inventory, R_xlen_t& done)
+{
+  typedef RLASRecordLayout<EXTENDED> L;
+
+  int rgb = (EXTENDED) ? 30 : ((format == 2) ? 20 : 28);
+  U8 returns = (1 << L::RETURN_BITS) - 1;
+
+  COLUMN(int, I, "Intensity", true);
+  COLUMN(int, RN, "ReturnNumber", true);
+  COLUMN(int, NR, "NumberOfReturns", true);
+  COLUMN(int, D, "ScanDirectionFlag", true);
+  COLUMN(int, E, "EdgeOfFlightline", true);
+  COLUMN(int, C, "Classification", true);
+  COLUMN(int, S, "Synthetic_flag", true);
+  COLUMN(int, K, "Keypoint_flag", true);
+  COLUMN(int, W, "Withheld_flag", true);
+  COLUMN(int, O, "Overlap_flag", EXTENDED);
+  COLUMN(int, U, "UserData", true);
+  COLUMN(int, P, "PointSourceID", true);
+  COLUMN(double, T, "gpstime", true);
+  COLUMN(int, Red, "R", true);
+  COLUMN(int, Gre, "G", true);
+  COLUMN(int, Blu, "B", true);
+  COLUMN(int, NIR, "NIR", true);
+  COLUMN(int, SAR, "ScanAngleRank", !EXTENDED);
+  COLUMN(double, ESA, "ScanAngle", EXTENDED);
+  COLUMN(int, CHA, "ScannerChannel", EXTENDED);
+
+  bool count_returns = cRN.present();
+
+  std::vector<U8> buffer((size_t)size*std::min<R_xlen_t>(npoints, RLAS_WRITE_BATCH));
+  U8* records = buffer.data();
+  U32 n;
+
+  for (R_xlen_t first = 0 ; first < npoints ; first += n)
+  {
+    n = (U32)std::min<R_xlen_t>(npoints - first, RLAS_WRITE_BATCH);
+    RLASPointIndex idx = {first, NULL};
+    I64 position = offset + (I64)first*size;
+
+    in->seek(position);
+    in->getBytes(records, n*size);
+
+    if (cI.present())   fill_column(records, size, n, cI, idx, [](U8* r, int x) { put(r+12, (U16)x); });
+    if (cRN.present())  fill_column(records, size, n, cRN, idx, [&](U8* r, int x) { r[L::RETURNS] = (r[L::RETURNS] & ~returns) | ((U8)x & returns); });
+    if (cNR.present())  fill_column(records, size, n, cNR, idx, [&](U8* r, int x) { r[L::RETURNS] = (r[L::RETURNS] & ~(returns << L::RETURN_BITS)) | (((U8)x & returns) << L::RETURN_BITS); });
+    if (cD.present())   fill_column(records, size, n, cD, idx, [](U8* r, int x) { r[L::DIRECTION] = (r[L::DIRECTION] & ~0x40) | (((U8)x & 1) << 6); });
+    if (cE.present())   fill_column(records, size, n, cE, idx, [](U8* r, int x) { r[L::DIRECTION] = (r[L::DIRECTION] & ~0x80) | (((U8)x & 1) << 7); });
+    if (cC.present())   fill_column(records, size, n, cC, idx, [](U8* r, int x) { r[L::CLASSIFICATION] = (r[L::CLASSIFICATION] & ~L::CLASSIFICATION_MASK) | ((U8)x & L::CLASSIFICATION_MASK); });
+    if (cS.present())   fill_column(records, size, n, cS, idx, [](U8* r, int x) { r[L::FLAGS] = (r[L::FLAGS] & ~(1 << L::FLAGS_SHIFT)) | (((U8)x != 0) << L::FLAGS_SHIFT); });
+    if (cK.present())   fill_column(records, size, n, cK, idx, [](U8* r, int x) { r[L::FLAGS] = (r[L::FLAGS] & ~(1 << (L::FLAGS_SHIFT + 1))) | (((U8)x != 0) << (L::FLAGS_SHIFT + 1)); });
+    if (cW.present())   fill_column(records, size, n, cW, idx, [](U8* r, int x) { r[L::FLAGS] = (r[L::FLAGS] & ~(1 << (L::FLAGS_SHIFT + 2))) | (((U8)x != 0) << (L::FLAGS_SHIFT + 2)); });
+    if (cO.present())   fill_column(records, size, n, cO, idx, [](U8* r, int x) { r[L::FLAGS] = (r[L::FLAGS] & ~0x08) | (((U8)x & 1) << 3); });
+    if (cCHA.present()) fill_column(records, size, n, cCHA, idx, [](U8* r, int x) { r[L::FLAGS] = (r[L::FLAGS] & ~0x30) | (((U8)x & 3) << 4); });
+    if (cSAR.present()) fill_column(records, size, n, cSAR, idx, [](U8* r, int x) { r[L::SCAN_ANGLE] = (U8)(I8)x; });
+    if (cESA.present()) fill_column(records, size, n, cESA, idx, [](U8* r, double x) { put(r+L::SCAN_ANGLE, (I16)(x/0.006f)); });
+    if (cU.present())   fill_column(records, size, n, cU, idx, [](U8* r, int x) { r[L::USER_DATA] = (U8)x; });
+    if (cP.present())   fill_column(records, size, n, cP, idx, [](U8* r, int x) { put(r+L::POINT_SOURCE_ID, (U16)x); });
+    if (cT.present())   fill_column(records, size, n, cT, idx, [](U8* r, double x) { put(r+L::GPSTIME, (F64)x); });
+    if (cRed.present()) fill_column(records, size, n, cRed, idx, [&](U8* r, int x) { put(r+rgb, (U16)x); });
+    if (cGre.present()) fill_column(records, size, n, cGre, idx, [&](U8* r, int x) { put(r+rgb+2, (U16)x); });
+    if (cBlu.present()) fill_column(records, size, n, cBlu, idx, [&](U8* r, int x) { put(r+rgb+4, (U16)x); });
+    if (cNIR.present()) fill_column(records, size, n, cNIR, idx, [](U8* r, int x) { put(r+36, (U16)x); });
+
+    out->seek(position);
+    if (!out->putBytes(records, n*size))
+      throw std::runtime_error("write");
+
+    done = first + n;
+
+    if (count_returns)
+      inventory.add(records, n, size, EXTENDED);
+  }
+}
+
+void write_points(LASwriter* laswriter, class LASheader& header, List data, std::vector<RLASExtrabyteAttributes>& ExtraBytesAttr, const RLASWriteOrder* order, RLASWaveformWriter* waveform)
+{
+  if (header.point_data_format >= 6)
+    write_records<true>(laswriter, header, data, ExtraBytesAttr, order, waveform);
+  else
+    write_records<false>(laswriter, header, data, ExtraBytesAttr, order, waveform);
+}
+
+// Writes columns of the points in the records of an existing las file. The records have a fixed
+// size so only the batches of records are read and written back, the other bytes of the file are
+// not. The number of points by return of the header is updated when the return numbers change, once
+// all the records are written. This is not atomic: on error the records already written keep their
+// new values and the header is not updated.
+// [[Rcpp::export]]
+void C_writer_columns(CharacterVector file, List data)
+{
+  std::string path = as<std::string>(file);
+
+  LASreadOpener lasreadopener;
+  lasreadopener.set_file_name(path.c_str());
+  std::unique_ptr<LASreader> lasreader(lasreadopener.open());
+
+  if (!lasreader)
+    stop("LASlib internal error. See message above.");
+
+  const class LASheader& header = lasreader->header;
+  int format = header.point_data_format;
+  U32 size = header.point_data_record_length;
+  int version_minor = header.version_minor;
+  U16 header_size = header.header_size;
+  R_xlen_t npoints = (R_xlen_t)lasreader->npoints;
+  bool compressed = header.laszip && header.laszip->compressor != LASZIP_COMPRESSOR_NONE;
+  lasreader->close();
+  lasreader.reset();
+
+  if (compressed)
+    stop("The points of a laz file cannot be modified in place.");
+
+  CharacterVector names = data.names();
+  for (R_xlen_t i = 0 ; i < data.size() ; i++)
+  {
+    std::string name = as<std::string>(names[i]);
+
+    if (!is_patchable(name, format))
+      stop("The attribute '%s' cannot be written in place in a file of point data format %d.", name.c_str(), format);
+
+    R_xlen_t n = Rf_xlength(data[i]);
+    if (n != npoints && n != 1)
+      stop("The attribute '%s' has %.0f values. The file has %.0f points.", name.c_str(), (double)n, (double)npoints);
+  }
+
+  std::unique_ptr<FILE, int(*)(FILE*)> f(fopen(path.c_str(), "r+b"), fclose);
+  if (!f)
+    stop("Cannot open the file '%s' for update.", path.c_str());
+
+  std::unique_ptr<ByteStreamIn> in;
+  std::unique_ptr<ByteStreamOut> out;
+  if (IS_LITTLE_ENDIAN())
+  {
+    in.reset(new ByteStreamInFileLE(f.get()));
+    out.reset(new ByteStreamOutFileLE(f.get()));
   }
   else
   {
-    if (RN.size() == 1) { r = false; point.set_extended_return_number((U8)RN[0]); }
-    if (NR.size() == 1) { n = false; point.set_extended_number_of_returns((U8)NR[0]); }
-    if (C.size() == 1)  { c = false; point.set_extended_classification((U8)C[0]); }
-    if (ESA.size() == 1){ esa = false; point.set_extended_scan_angle((I16)((ESA[0]/0.006f))); }
+    in.reset(new ByteStreamInFileBE(f.get()));
+    out.reset(new ByteStreamOutFileBE(f.get()));
   }
-  if (D.size() == 1) { d = false; point.set_scan_direction_flag((U8)D[0]); }
-  if (E.size() == 1) { e = false; point.set_edge_of_flight_line((U8)E[0]); }
-  if (S.size() == 1) { s = false; point.set_synthetic_flag((U8)S[0]); }
-  if (K.size() == 1) { k = false; point.set_keypoint_flag((U8)K[0]); }
-  if (W.size() == 1) { w = false; point.set_withheld_flag((U8)W[0]); }
-  if (O.size() == 1) { o = false; point.set_extended_overlap_flag((U8)O[0]); }
-  if (U.size() == 1) { u = false; point.set_user_data((U8)U[0]); }
-  if (P.size() == 1) { p = false; point.set_point_source_ID((U16)P[0]); }
 
-  for(int j = 0 ; j < X.length() ; j++)
+  LASinventory inventory;
+  R_xlen_t done = 0;
+  bool ok = true;
+
+  try
   {
-    // Add regular data
-    point.set_x(X[j]);
-    point.set_y(Y[j]);
-    point.set_z(Z[j]);
+    // The offset to the points as it is stored in the file (LASreaderLAS does not count the
+    // records it removes)
+    U32 offset_to_point_data;
+    in->seek(96);
+    in->get32bitsLE((U8*)&offset_to_point_data);
+
+    if (format >= 6)
+      patch_records<true>(in.get(), out.get(), offset_to_point_data, format, size, npoints, data, inventory, done);
+    else
+      patch_records<false>(in.get(), out.get(), offset_to_point_data, format, size, npoints, data, inventory, done);
+
+    ok = fflush(f.get()) == 0;
+  }
+  catch (...)
+  {
+    ok = false;
+  }
 
-    if(i) { point.set_intensity((U16)I[j]); }
+  if (!ok)
+    stop("Cannot write the points of the file. Up to the first %.0f points were modified in place. The header was not updated.", (double)done);
 
-    if(r && !extended) { point.set_return_number((U8)RN[j]); }
-    if(r &&  extended) { point.set_extended_return_number((U8)RN[j]); }
+  // Same counters as LASwriterLAS::update_header()
+  try
+  {
+    if (inventory.active())
+    {
+      out->seek(111);
+      for (int i = 0 ; i < 5 ; i++)
+      {
+        I64 count = inventory.extended_number_of_points_by_return[i+1];
+        U32 number = (format >= 6) ? 0 : ((count > U32_MAX) ? ((version_minor >= 4) ? 0 : U32_MAX) : (U32)count);
+        ok = ok && out->put32bitsLE((U8*)&number);
+      }
 
-    if(n && !extended) { point.set_number_of_returns((U8)NR[j]); }
-    if(n &&  extended) { point.set_extended_number_of_returns((U8)NR[j]); }
+      if (version_minor >= 4 && header_size >= 375)
+      {
+        out->seek(255);
+        for (int i = 0 ; i < 15 ; i++)
+          ok = ok && out->put64bitsLE((U8*)&inventory.extended_number_of_points_by_return[i+1]);
+      }
+    }
+
+    ok = ok && fflush(f.get()) == 0;
+  }
+  catch (...)
+  {
+    ok = false;
+  }
+
+  if (!ok)
+    stop("Cannot write the number of points by return in the header. The points were modified.");
+}
+
+void write_points(LASwriter* laswriter, class LASheader& header, const ArrowSchema* schema, const ArrowArray* array, std::vector<RLASExtrabyteAttributes>& ExtraBytesAttr)
+{
+  bool extended = (header.version_minor >= 4) && (header.point_data_format >= 6);
+
+  LASpoint point;
+  point.init(&header, header.point_data_format, header.point_data_record_length, 0);
+
+  RLASArrowColumn X, Y, Z, I, RN, NR, D, E, C, S, K, W, O, U, P, T, Red, Gre, Blu, NIR, SAR, ESA, CHA;
+
+  #define FIND(NAME, COL) arrow_find_column(schema, array, NAME, COL)
+
+  if (!FIND("X", X) || !FIND("Y", Y) || !FIND("Z", Z))
+    stop("Columns X, Y and Z are required.");
+
+  bool i = FIND("Intensity", I);
+  bool r = FIND("ReturnNumber", RN);
+  bool n = FIND("NumberOfReturns", NR);
+  bool d = FIND("ScanDirectionFlag", D);
+  bool e = FIND("EdgeOfFlightline", E);
+  bool c = FIND("Classification", C);
+  bool s = FIND("Synthetic_flag", S);
+  bool k = FIND("Keypoint_flag", K);
+  bool w = FIND("Withheld_flag", W);
+  bool o = FIND("Overlap_flag", O) && extended;
+  bool u = FIND("UserData", U);
+  bool p = FIND("PointSourceID", P);
+  bool t = FIND("gpstime", T);
+  bool R = FIND("R", Red);
+  bool G = FIND("G", Gre);
+  bool B = FIND("B", Blu);
+  bool N = FIND("NIR", NIR);
+  bool sar = FIND("ScanAngleRank", SAR);
+  bool esa = FIND("ScanAngle", ESA);
+  bool cha = FIND("ScannerChannel", CHA) && extended;
+
+  std::vector<RLASArrowColumn> EB(ExtraBytesAttr.size());
+  for (size_t j = 0 ; j < ExtraBytesAttr.size() ; j++)
+    FIND(ExtraBytesAttr[j].name.c_str(), EB[j]);
+
+  for(int64_t j = 0 ; j < array->length ; j++)
+  {
+    point.set_x(X.get_double(j));
+    point.set_y(Y.get_double(j));
+    point.set_z(Z.get_double(j));
+
+    if(i) { point.set_intensity((U16)I.get_int(j)); }
+
+    if(r && !extended) { point.set_return_number((U8)RN.get_int(j)); }
+    if(r &&  extended) { point.set_extended_return_number((U8)RN.get_int(j)); }
+
+    if(n && !extended) { point.set_number_of_returns((U8)NR.get_int(j)); }
+    if(n &&  extended) { point.set_extended_number_of_returns((U8)NR.get_int(j)); }
 
-    if(d) { point.set_scan_direction_flag((U8)D[j]); }
-    if(e) { point.set_edge_of_flight_line((U8)E[j]); }
+    if(d) { point.set_scan_direction_flag((U8)D.get_int(j)); }
+    if(e) { point.set_edge_of_flight_line((U8)E.get_int(j)); }
 
-    if(c && !extended) { point.set_classification((U8)C[j]); }
-    if(c &&  extended) { point.set_extended_classification((U8)C[j]); }
+    if(c && !extended) { point.set_classification((U8)C.get_int(j)); }
+    if(c &&  extended) { point.set_extended_classification((U8)C.get_int(j)); }
 
-    if(cha) { point.set_extended_scanner_channel((U8)CHA[j]); }
+    if(cha) { point.set_extended_scanner_channel((U8)CHA.get_int(j)); }
 
-    if(s) { point.set_synthetic_flag((U8)S[j]); }
-    if(k) { point.set_keypoint_flag((U8)K[j]); }
-    if(w) { point.set_withheld_flag((U8)W[j]); }
-    if(o) { point.set_extended_overlap_flag((U8)O[j]); }
+    if(s) { point.set_synthetic_flag((U8)S.get_int(j)); }
+    if(k) { point.set_keypoint_flag((U8)K.get_int(j)); }
+    if(w) { point.set_withheld_flag((U8)W.get_int(j)); }
+    if(o) { point.set_extended_overlap_flag((U8)O.get_int(j)); }
 
-    if(sar) { point.set_scan_angle_rank((I8)SAR[j]); }
-    if(esa) { point.set_extended_scan_angle((I16)((ESA[j]/0.006f))); }
+    if(sar) { point.set_scan_angle_rank((I8)SAR.get_int(j)); }
+    if(esa) { point.set_extended_scan_angle((I16)((ESA.get_double(j)/0.006f))); }
 
-    if(u) { point.set_user_data((U8)U[j]); }
-    if(p) { point.set_point_source_ID((U16)P[j]); }
-    if(t) { point.set_gps_time((F64)T[j]); }
-    if(R) { point.set_R((U16)Red[j]); }
-    if(G) { point.set_G((U16)Gre[j]); }
-    if(B) { point.set_B((U16)Blu[j]); }
-    if(N) { point.set_NIR((U16)NIR[j]); }
+    if(u) { point.set_user_data((U8)U.get_int(j)); }
+    if(p) { point.set_point_source_ID((U16)P.get_int(j)); }
+    if(t) { point.set_gps_time((F64)T.get_double(j)); }
+    if(R) { point.set_R((U16)Red.get_int(j)); }
+    if(G) { point.set_G((U16)Gre.get_int(j)); }
+    if(B) { point.set_B((U16)Blu.get_int(j)); }
+    if(N) { point.set_NIR((U16)NIR.get_int(j)); }
 
     // Add extra bytes
-    for(auto& ExtraByte : ExtraBytesAttr)
-      ExtraByte.set_attribute(j, &point);
+    for (size_t m = 0 ; m < ExtraBytesAttr.size() ; m++)
+    {
+      double value = (EB[m].is_na(j)) ? NA_REAL : EB[m].get_double(j);
+      ExtraBytesAttr[m].set_attribute_value(value, &point);
+    }
 
     laswriter->write_point(&point);
     laswriter->update_inventory(&point);
   }
-
-  laswriter->update_header(&header, true);
-  laswriter->close();
-  delete laswriter;
 }
 
 void set_global_enconding(LASheader &header, List encoding)
@@ -44,6 +44,30 @@
 
 using namespace Rcpp;
 
+// Quadtree of a lax file. The size of the tiles depends on the extent of the point cloud.
+LASquadtree* lax_quadtree(F64 min_x, F64 max_x, F64 min_y, F64 max_y)
+{
+  LASquadtree* lasquadtree = new LASquadtree;
+
+  float w = max_x - min_x;
+  float h = max_y - min_y;
+  F32 t;
+
+  if ((w < 1000) && (h < 1000))
+    t = 10.0;
+  else if ((w < 10000) && (h < 10000))
+    t = 100.0;
+  else if ((w < 100000) && (h < 100000))
+    t = 1000.0;
+  else if ((w < 1000000) && (h < 1000000))
+    t = 10000.0;
+  else
+    t = 100000.0;
+
+  lasquadtree->setup(min_x, max_x, min_y, max_y, t);
+  return lasquadtree;
+}
+
 // [[Rcpp::export]]
 void laxwriter(CharacterVector file, bool verbose)
 {
@@ -65,24 +89,11 @@ void laxwriter(CharacterVector file, bool verbose)
 
     // setup the quadtree
 
-    LASquadtree* lasquadtree = new LASquadtree;
-
-    float w = lasreader->header.max_x - lasreader->header.min_x;
-    float h = lasreader->header.max_y - lasreader->header.min_y;
-    F32 t;
-
-    if ((w < 1000) && (h < 1000))
-      t = 10.0;
-    else if ((w < 10000) && (h < 10000))
-      t = 100.0;
-    else if ((w < 100000) && (h < 100000))
-      t = 1000.0;
-    else if ((w < 1000000) && (h < 1000000))
-      t = 10000.0;
-    else
-      t = 100000.0;
+    LASquadtree* lasquadtree = lax_quadtree(lasreader->header.min_x, lasreader->header.max_x, lasreader->header.min_y, lasreader->header.max_y);
 
-    lasquadtree->setup(lasreader->header.min_x, lasreader->header.max_x, lasreader->header.min_y, lasreader->header.max_y, t);
+    // The lax format stores point indices on 32 bits
+    if (lasreader->npoints > (I64)U32_MAX)
+      throw std::runtime_error("Cannot index a file of more than 4294967295 points.");
 
     LASindex lasindex;
     lasindex.prepare(lasquadtree, 1000);
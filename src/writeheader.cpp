@@ -0,0 +1,421 @@
+/*
+ ===============================================================================
+
+ PROGRAMMERS:
+
+ jean-romain.roussel.1@ulaval.ca  -  https://github.com/Jean-Romain/rlas
+
+ COPYRIGHT:
+
+ Copyright 2017-2019 Jean-Romain Roussel
+
+ This file is part of rlas R package.
+
+ rlas is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+ ===============================================================================
+ */
+
+#include <Rcpp.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "lasreader.hpp"
+#include "bytestreamin_file.hpp"
+#include "bytestreamout_file.hpp"
+#include "rlasextrabytesattributes.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace Rcpp;
+
+void set_header(LASheader&, List, CharacterVector, std::vector<RLASExtrabyteAttributes>&);
+void check_point_layout(const LASheader&, const LASheader&);
+
+// A variable length record as it is stored in the file: the header of the record (54 bytes, 60
+// bytes for an EVLR) followed by its payload
+struct RLASRecord
+{
+  std::string user_id;
+  U16 record_id;
+  std::vector<U8> bytes;
+};
+
+// The records built by set_header() from the list returned by read.lasheader(). They are replaced
+// by the records of the header. The other records of the file (LASzip, COPC, ...) are kept as they are.
+static bool is_header_record(const RLASRecord& record)
+{
+  if (record.user_id == "LASF_Projection")
+    return record.record_id == 34735 || record.record_id == 34736 || record.record_id == 34737 || record.record_id == 2112;
+
+  if (record.user_id == "LASF_Spec")
+    return record.record_id == 3 || record.record_id == 4 || (record.record_id >= 100 && record.record_id <= 354);
+
+  return false;
+}
+
+static void put_le(std::vector<U8>& bytes, U64 value, int size)
+{
+  for (int i = 0 ; i < size ; i++) bytes.push_back((U8)(value >> (8*i)));
+}
+
+static U64 get_le(const U8* bytes, int size)
+{
+  U64 value = 0;
+  for (int i = size-1 ; i >= 0 ; i--) value = (value << 8) | bytes[i];
+  return value;
+}
+
+static RLASRecord make_record(U16 reserved, const CHAR* user_id, U16 record_id, I64 length, const CHAR* description, const U8* data, bool extended)
+{
+  RLASRecord record;
+  record.user_id = std::string(user_id, 16).c_str();
+  record.record_id = record_id;
+  put_le(record.bytes, reserved, 2);
+  record.bytes.insert(record.bytes.end(), (const U8*)user_id, (const U8*)user_id + 16);
+  put_le(record.bytes, record_id, 2);
+  put_le(record.bytes, (U64)length, extended ? 8 : 2);
+  record.bytes.insert(record.bytes.end(), (const U8*)description, (const U8*)description + 32);
+  if (length > 0) record.bytes.insert(record.bytes.end(), data, data + length);
+  return record;
+}
+
+// The same record as an EVLR
+static RLASRecord to_extended(const RLASRecord& vlr)
+{
+  const U8* b = vlr.bytes.data();
+  return make_record((U16)get_le(b, 2), (const CHAR*)b + 2, vlr.record_id, (I64)vlr.bytes.size() - 54, (const CHAR*)b + 22, b + 54, true);
+}
+
+static bool read_records(ByteStreamIn* in, I64 start, U32 n, bool extended, I64 end, std::vector<RLASRecord>& records)
+{
+  I64 size = extended ? 60 : 54;
+  I64 position = start;
+
+  for (U32 i = 0 ; i < n ; i++)
+  {
+    if (position + size > end) return false;
+
+    RLASRecord record;
+    record.bytes.resize(size);
+    in->seek(position);
+    in->getBytes(record.bytes.data(), (U32)size);
+
+    I64 length = (I64)get_le(&record.bytes[20], extended ? 8 : 2);
+    if (position + size + length > end) return false;
+
+    record.bytes.resize(size + length);
+    if (length > 0) in->getBytes(&record.bytes[size], (U32)length);
+    record.user_id = std::string((const CHAR*)&record.bytes[2], 16).c_str();
+    record.record_id = (U16)get_le(&record.bytes[18], 2);
+    records.push_back(record);
+    position += size + length;
+  }
+
+  return true;
+}
+
+static std::vector<U8> concatenate(const std::vector<RLASRecord>& records)
+{
+  std::vector<U8> bytes;
+  for (const RLASRecord& record : records) bytes.insert(bytes.end(), record.bytes.begin(), record.bytes.end());
+  return bytes;
+}
+
+static bool truncate_file(FILE* file, I64 size)
+{
+  if (fflush(file) != 0) return false;
+#ifdef _WIN32
+  return _chsize_s(_fileno(file), size) == 0;
+#else
+  return ftruncate(fileno(file), (off_t)size) == 0;
+#endif
+}
+
+// Moves the bytes [start, end) of the file delta bytes further. The blocks are copied from the end.
+static void shift_bytes(ByteStreamIn* in, ByteStreamOut* out, I64 start, I64 end, I64 delta)
+{
+  const I64 block = 1 << 22;
+  std::vector<U8> buffer(block);
+
+  for (I64 position = end ; position > start ; )
+  {
+    I64 n = std::min(block, position - start);
+    position -= n;
+    in->seek(position);
+    in->getBytes(buffer.data(), (U32)n);
+    out->seek(position + delta);
+    if (!out->putBytes(buffer.data(), (U32)n)) throw std::runtime_error("write");
+  }
+}
+
+// Writes the header of an existing file in place. The public header and the VLRs are rewritten and
+// the points are not read. When the VLRs no longer fit before the points, the WKT of a LAS 1.4
+// file is moved in an EVLR. Otherwise the bytes of the points are moved (not decoded) and the
+// positions recorded in the file (chunk table of a laz file, waveform packets, EVLRs) are updated.
+// [[Rcpp::export]]
+void lasheaderwriter(CharacterVector file, List LASheader, CharacterVector columns)
+{
+  std::string path = as<std::string>(file);
+
+  LASreadOpener lasreadopener;
+  lasreadopener.set_file_name(path.c_str());
+  std::unique_ptr<LASreader> lasreader(lasreadopener.open());
+
+  if (!lasreader)
+    stop("LASlib internal error. See message above.");
+
+  class LASheader header;
+  std::vector<RLASExtrabyteAttributes> ExtraBytesAttr;
+  set_header(header, LASheader, columns, ExtraBytesAttr);
+
+  const class LASheader& existing = lasreader->header;
+  check_point_layout(existing, header);
+
+  if (existing.header_size != header.header_size)
+    stop("The header size of the header (%d) is not the header size of the file (%d).", header.header_size, existing.header_size);
+
+  bool copc = existing.vlr_copc_info || existing.get_vlr("copc", 1);
+  bool indexed = existing.laszip && existing.laszip->number_of_special_evlrs > 0;
+  bool chunked = existing.laszip && existing.laszip->compressor != LASZIP_COMPRESSOR_NONE && existing.laszip->compressor != LASZIP_COMPRESSOR_POINTWISE;
+  bool extended = existing.version_minor >= 4 && existing.header_size >= 375;
+  U16 header_size = existing.header_size;
+
+  // The location of the waveform packets is a property of the file
+  U16 global_encoding = (header.global_encoding & ~6) | (existing.global_encoding & 6);
+
+  lasreader->close();
+  lasreader.reset();
+
+  std::unique_ptr<FILE, int(*)(FILE*)> f(fopen(path.c_str(), "r+b"), fclose);
+  if (!f)
+    stop("Cannot open the file '%s' for update.", path.c_str());
+
+  std::unique_ptr<ByteStreamIn> in;
+  std::unique_ptr<ByteStreamOut> out;
+  if (IS_LITTLE_ENDIAN())
+  {
+    in.reset(new ByteStreamInFileLE(f.get()));
+    out.reset(new ByteStreamOutFileLE(f.get()));
+  }
+  else
+  {
+    in.reset(new ByteStreamInFileBE(f.get()));
+    out.reset(new ByteStreamOutFileBE(f.get()));
+  }
+
+  // The records of the file as they are stored
+
+  U32 offset_to_point_data = 0;
+  U32 number_of_vlrs = 0;
+  U64 start_of_waveform = 0;
+  U64 start_of_evlrs = 0;
+  U32 number_of_evlrs = 0;
+  I64 file_size = 0;
+  I64 chunk_table_start_position = 0;
+  std::vector<RLASRecord> vlrs;
+  std::vector<RLASRecord> evlrs;
+  bool ok;
+
+  try
+  {
+    in->seek(96);
+    in->get32bitsLE((U8*)&offset_to_point_data);
+    in->get32bitsLE((U8*)&number_of_vlrs);
+
+    if (header_size >= 235)
+    {
+      in->seek(227);
+      in->get64bitsLE((U8*)&start_of_waveform);
+    }
+
+    if (extended)
+    {
+      in->seek(235);
+      in->get64bitsLE((U8*)&start_of_evlrs);
+      in->get32bitsLE((U8*)&number_of_evlrs);
+    }
+
+    if (chunked)
+    {
+      in->seek(offset_to_point_data);
+      in->get64bitsLE((U8*)&chunk_table_start_position);
+    }
+
+    in->seekEnd();
+    file_size = in->tell();
+
+    ok = read_records(in.get(), header_size, number_of_vlrs, false, offset_to_point_data, vlrs);
+    ok = ok && (number_of_evlrs == 0 || read_records(in.get(), (I64)start_of_evlrs, number_of_evlrs, true, file_size, evlrs));
+  }
+  catch (...)
+  {
+    ok = false;
+  }
+
+  if (!ok)
+    stop("Cannot read the variable length records of the file.");
+
+  // The new records: the records of the file that the header does not describe and the records of
+  // the header
+
+  std::vector<RLASRecord> new_vlrs;
+  std::vector<RLASRecord> new_evlrs;
+
+  for (const RLASRecord& record : vlrs)
+    if (!is_header_record(record)) new_vlrs.push_back(record);
+
+  for (const RLASRecord& record : evlrs)
+    if (!is_header_record(record)) new_evlrs.push_back(record);
+
+  for (U32 i = 0 ; i < header.number_of_variable_length_records ; i++)
+  {
+    const LASvlr& vlr = header.vlrs[i];
+    new_vlrs.push_back(make_record(vlr.reserved, vlr.user_id, vlr.record_id, vlr.record_length_after_header, vlr.description, vlr.data, false));
+  }
+
+  for (U32 i = 0 ; extended && i < header.number_of_extended_variable_length_records ; i++)
+  {
+    const LASevlr& evlr = header.evlrs[i];
+    new_evlrs.push_back(make_record(evlr.reserved, evlr.user_id, evlr.record_id, evlr.record_length_after_header, evlr.description, evlr.data, true));
+  }
+
+  I64 needed = header_size + (I64)concatenate(new_vlrs).size();
+
+  if (needed > offset_to_point_data && extended)
+  {
+    for (size_t i = 0 ; i < new_vlrs.size() ; i++)
+    {
+      if (new_vlrs[i].user_id == "LASF_Projection" && new_vlrs[i].record_id == 2112)
+      {
+        needed -= new_vlrs[i].bytes.size();
+        new_evlrs.push_back(to_extended(new_vlrs[i]));
+        new_vlrs.erase(new_vlrs.begin() + i);
+        break;
+      }
+    }
+  }
+
+  I64 delta = (needed > offset_to_point_data) ? needed - offset_to_point_data : 0;
+  I64 end_of_points = (number_of_evlrs > 0 && (I64)start_of_evlrs >= offset_to_point_data) ? (I64)start_of_evlrs : file_size;
+  bool update_evlrs = extended && (delta > 0 || concatenate(new_evlrs) != concatenate(evlrs));
+
+  if (needed + delta > (I64)U32_MAX)
+    stop("The variable length records are too large.");
+
+  if (copc && delta > 0)
+    stop("The variable length records do not fit before the points. The points of a COPC file cannot be moved.");
+
+  if (copc && update_evlrs)
+    stop("The extended variable length records of a COPC file cannot be modified.");
+
+  if (indexed && (delta > 0 || update_evlrs))
+    stop("The points and the extended variable length records of a laz file with an internal index cannot be moved.");
+
+  // Everything is checked before the first byte is moved so an error leaves the file untouched
+
+  // -1: the position is at the end of the points (laz file written in a stream)
+  if (chunked && delta > 0 && chunk_table_start_position == -1)
+    stop("The variable length records do not fit before the points. The points of a laz file written in a stream cannot be moved.");
+
+  if (chunked && delta > 0 && (chunk_table_start_position < (I64)offset_to_point_data + 8 || chunk_table_start_position > end_of_points))
+    stop("The chunk table of the laz file is corrupted.");
+
+  ok = true;
+
+  try
+  {
+    // The bytes of the points, of the chunk table and of the waveform packets are moved as they are
+
+    if (delta > 0)
+    {
+      shift_bytes(in.get(), out.get(), offset_to_point_data, end_of_points, delta);
+
+      if (chunked)
+      {
+        chunk_table_start_position += delta;
+        out->seek(offset_to_point_data + delta);
+        ok = ok && out->put64bitsLE((U8*)&chunk_table_start_position);
+      }
+
+      if ((global_encoding & 2) && start_of_waveform >= offset_to_point_data)
+      {
+        start_of_waveform += delta;
+        out->seek(227);
+        ok = ok && out->put64bitsLE((U8*)&start_of_waveform);
+      }
+    }
+
+    // The public header. The counts, the bounding box, the scale factors and the offsets describe
+    // the points that are not modified.
+
+    U32 new_offset_to_point_data = offset_to_point_data + (U32)delta;
+    U32 new_number_of_vlrs = (U32)new_vlrs.size();
+
+    out->seek(4);
+    ok = ok && out->put16bitsLE((U8*)&header.file_source_ID);
+    ok = ok && out->put16bitsLE((U8*)&global_encoding);
+    ok = ok && out->put32bitsLE((U8*)&header.project_ID_GUID_data_1);
+    ok = ok && out->put16bitsLE((U8*)&header.project_ID_GUID_data_2);
+    ok = ok && out->put16bitsLE((U8*)&header.project_ID_GUID_data_3);
+    ok = ok && out->putBytes((U8*)header.project_ID_GUID_data_4, 8);
+    out->seek(90);
+    ok = ok && out->put16bitsLE((U8*)&header.file_creation_day);
+    ok = ok && out->put16bitsLE((U8*)&header.file_creation_year);
+    out->seek(96);
+    ok = ok && out->put32bitsLE((U8*)&new_offset_to_point_data);
+    ok = ok && out->put32bitsLE((U8*)&new_number_of_vlrs);
+
+    // The VLRs. The space left before the points is filled with zeros (user data after header).
+
+    std::vector<U8> bytes = concatenate(new_vlrs);
+    bytes.resize(new_offset_to_point_data - header_size, 0);
+    out->seek(header_size);
+    ok = ok && (bytes.empty() || out->putBytes(bytes.data(), (U32)bytes.size()));
+
+    // The EVLRs follow the points
+
+    if (update_evlrs)
+    {
+      U64 new_start_of_evlrs = new_evlrs.empty() ? 0 : end_of_points + delta;
+      U32 new_number_of_evlrs = (U32)new_evlrs.size();
+
+      bytes = concatenate(new_evlrs);
+      out->seek(end_of_points + delta);
+      ok = ok && (bytes.empty() || out->putBytes(bytes.data(), (U32)bytes.size()));
+      ok = ok && truncate_file(f.get(), end_of_points + delta + (I64)bytes.size());
+
+      out->seek(235);
+      ok = ok && out->put64bitsLE((U8*)&new_start_of_evlrs);
+      ok = ok && out->put32bitsLE((U8*)&new_number_of_evlrs);
+    }
+  }
+  catch (...)
+  {
+    ok = false;
+  }
+
+  if (!ok)
+    stop("Cannot write the header of the file. The file may be corrupted.");
+}